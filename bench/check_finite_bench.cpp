@@ -0,0 +1,56 @@
+/*
+ * Throughput of dout_CHECK_FINITE against a std::isfinite loop.
+ * Usage: check_finite_bench [number of elements, default 2^24]
+ */
+
+#include <fsc/DebugPrinter.hpp>
+
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+using fsc::dout;
+
+namespace {
+
+template <typename T>
+std::size_t naive(const std::vector<T> & v) {
+  std::size_t bad = 0;
+  for(const T x : v)
+    bad += !std::isfinite(x);
+  return bad;
+}
+
+template <typename F>
+double best_seconds(F && f) {
+  double best = 1e300;
+  for(int rep = 0; rep < 5; ++rep) {
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+    best = std::min(best, dt.count());
+  }
+  return best;
+}
+
+template <typename T>
+void run(const std::size_t n, const char * name) {
+  std::vector<T> v(n, T(1));
+  volatile std::size_t sink = 0;
+  const double gb = static_cast<double>(n * sizeof(T)) / 1e9;
+  const double t_naive = best_seconds([&] { sink = sink + naive(v); });
+  const double t_dout = best_seconds([&] { dout_CHECK_FINITE(v) });
+
+  std::cout << name << ": isfinite loop " << gb / t_naive
+            << " GB/s, dout_CHECK_FINITE " << gb / t_dout << " GB/s ("
+            << t_naive / t_dout << "x)" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char ** argv) {
+  const std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 24;
+  run<double>(n, "double");
+  run<float>(n, "float ");
+  return 0;
+}
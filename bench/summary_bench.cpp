@@ -0,0 +1,76 @@
+/*
+ * Throughput of dout_SUMMARY against a naive single-pass loop.
+ * Usage: summary_bench [number of elements, default 2^24]
+ */
+
+#include <fsc/DebugPrinter.hpp>
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+
+using fsc::dout;
+
+namespace {
+
+// Same statistics as DebugPrinter::summary(), computed the obvious way
+template <typename T>
+double naive(const std::vector<T> & v) {
+  std::size_t nan = 0, inf = 0, zero = 0, imin = 0, imax = 0, n = 0;
+  T lo = std::numeric_limits<T>::max(), hi = std::numeric_limits<T>::lowest();
+  double sum = 0, sum2 = 0;
+  for(std::size_t i = 0; i < v.size(); ++i) {
+    const T x = v[i];
+    if(std::isnan(x)) { ++nan; continue; }
+    if(std::isinf(x)) { ++inf; continue; }
+    if(x == 0) ++zero;
+    if(x < lo) { lo = x; imin = i; }
+    if(x > hi) { hi = x; imax = i; }
+    sum += x;
+    sum2 += static_cast<double>(x) * x;
+    ++n;
+  }
+  return sum + sum2 + lo + hi + double(nan + inf + zero + imin + imax + n);
+}
+
+template <typename F>
+double best_seconds(F && f) {
+  double best = 1e300;
+  for(int rep = 0; rep < 5; ++rep) {
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+    best = std::min(best, dt.count());
+  }
+  return best;
+}
+
+template <typename T>
+void run(const std::size_t n, const char * name) {
+  std::vector<T> v(n);
+  std::mt19937 gen(42);
+  std::normal_distribution<T> dist;
+  for(auto & x : v) x = dist(gen);
+  v[n / 2] = std::numeric_limits<T>::quiet_NaN();
+
+  std::ostream null(nullptr);           // discard the summary line
+  dout = null;
+  volatile double sink = 0;
+  const double gb = static_cast<double>(n * sizeof(T)) / 1e9;
+  const double t_naive = best_seconds([&] { sink = sink + naive(v); });
+  const double t_dout = best_seconds([&] { dout_SUMMARY(v) });
+  dout = std::cout;
+
+  std::cout << name << ": naive " << gb / t_naive << " GB/s, dout_SUMMARY "
+            << gb / t_dout << " GB/s (" << t_naive / t_dout << "x)" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char ** argv) {
+  const std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 24;
+  run<double>(n, "double");
+  run<float>(n, "float ");
+  return 0;
+}
@@ -11,6 +11,10 @@
 #include <fsc/DebugPrinter.hpp>
 
 #include <vector>
+#include <map>
+#include <chrono>
+
+enum class State { Idle, Running, Done };
 
 template <typename T, typename U>
 class Foo { public:
@@ -48,7 +52,13 @@ int main() {
 
     my_var.push_back(42);
     dout_VAL(my_var[0])                 // print highlighted var=val pair
-    dout_VAL(my_var)                    // std::vector has no ostream operator<<
+    dout_VAL(my_var)                    // containers are printed element-wise
+
+    std::map<int, std::vector<int>> my_map{{1, std::vector<int>(100, 7)}};
+    fsc::dout.set_max_elements(6);      // only show head and tail elements
+    dout_VAL(my_map)
+    dout_VAL(std::make_tuple(my_var[0], "text", std::chrono::milliseconds(5)))
+    dout_VAL(State::Running)            // enums are printed by name
 
     dout_HERE
 
@@ -0,0 +1,61 @@
+/*
+ * Demonstration of DebugPrinter profiling sites.
+ * The statistics are printed by dout.report() and again at program exit.
+ */
+
+//~ #define DEBUGPRINTER_NO_TSC         // optional to time with steady_clock
+#include <fsc/DebugPrinter.hpp>
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using fsc::dout;                        // saves some typing
+
+double work(int n) {
+    dout_TIMER("work")                  // times the rest of this scope
+    dout_HIST("n", n)                   // distribution of the argument
+    double x = 0;
+    for(int i = 0; i < n; ++i)
+        x += std::sqrt(i);
+    return x;
+}
+
+void step(int i, double & sum) {
+    dout_SCOPE("step")                  // nodes of the call tree
+    {
+        dout_SCOPE("small")
+        sum += work(i);
+    }
+    {
+        dout_SCOPE("large")
+        sum += work(10 * i);
+    }
+}
+
+int main() {
+
+    double sum = 0;
+    for(int i = 0; i < 1000; ++i) {
+        if(i % 3 == 0) {
+            dout_COUNT("multiple of 3")    // per-thread event counter
+        }
+        step(i, sum);
+    }
+
+    std::vector<std::thread> threads;   // threads are merged in the report
+    for(int t = 0; t < 4; ++t)
+        threads.emplace_back([] {
+            dout_TIMER_CPU("sleep")     // also tracks thread CPU time
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        });
+    for(auto & t : threads)
+        t.join();
+
+    dout_VAL(sum)
+    dout_BENCH(std::sqrt(sum))          // median time per evaluation
+    dout.report();                      // print now
+
+    dout.set_report_at_exit(false);     // don't print again at exit
+    return 0;
+}
@@ -7,6 +7,7 @@
  * \example 01_types.cpp
  * \example 02_flow.cpp
  * \example 03_advanced.cpp
+ * \example 04_profiling.cpp
  *
  * 
  * \file       DebugPrinter.hpp
@@ -53,10 +54,37 @@
  * `typeid(std::string).name()` output `Ss` to `std::string`). The stack and
  * type methods will then print the mangled names and a `c++filt`-ready output.
  * 
+ * Pass `DEBUGPRINTER_NO_SIMD` to use only the scalar code paths of the numeric
+ * methods (`dout_SUMMARY` and friends). Otherwise they are vectorised with
+ * GCC vector extensions on x86 and dispatched at runtime to SSE2, AVX2 or
+ * AVX-512.
+ * 
+ * Pass `DEBUGPRINTER_NO_TSC` to time `dout_TIMER` and friends with
+ * `std::chrono::steady_clock` instead of the (invariant) x86 time stamp
+ * counter.
+ * 
+ * Pass `DEBUGPRINTER_NO_PERF` to make `dout_PERF` time only, instead of
+ * reading Linux `perf_event_open` counters.
+ * 
+ * Define `DEBUGPRINTER_INSTRUMENT` in exactly one translation unit before
+ * including this header to record every function compiled with
+ * `-finstrument-functions` (see DebugPrinter::set_instrument_filter()).
+ * 
+ * Define `DEBUGPRINTER_USDT` (Linux, x86-64 or AArch64, GCC or Clang) to
+ * make dout_HERE, dout_VAL, dout_COUNT, dout_HIST, dout_STAT and the trace
+ * macros also fire SystemTap/USDT probes `debugprinter:*`, which tracers
+ * such as `bpftrace` or `perf` can attach to (see fsc::usdt).
+ * 
  * Pass `DEBUGPRINTER_NO_SIGNALS` to turn off automatic stack tracing when 
  * certain fatal signals occur. Passing this flag is recommended on
  * non-Unix-like systems.
  * 
+ * Enum values are printed by name if they lie within
+ * [`DEBUGPRINTER_ENUM_MIN`, `DEBUGPRINTER_ENUM_MAX`] (default [-128, 127]).
+ * The name table is built at compile time with one template instantiation
+ * per value, so keep the range small or set it per enum by specialising
+ * fsc::DebugPrinterEnumRange.
+ * 
  ******************************************************************************/
 
 // ToDo: constexpr DebugPrinter for compile-time debugging
@@ -66,11 +94,21 @@
 #define DEBUGPRINTER_HEADER
 
 #include <iostream>
+#include <initializer_list>                      // also for the OFF stubs
+#include <string>
+#include <vector>
 
 #ifdef NDEBUG
 #define DEBUGPRINTER_OFF
 #endif
 
+#ifndef DEBUGPRINTER_ENUM_MIN
+#define DEBUGPRINTER_ENUM_MIN -128
+#endif
+#ifndef DEBUGPRINTER_ENUM_MAX
+#define DEBUGPRINTER_ENUM_MAX 127
+#endif
+
 #ifndef DEBUGPRINTER_OFF
 
 #include <iomanip>
@@ -82,6 +120,37 @@
 #include <stdexcept>
 #include <memory>
 #include <type_traits>
+#include <limits>
+#include <iterator>
+#include <utility>
+#include <tuple>
+#include <chrono>
+#include <ratio>
+#include <cstring>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <atomic>
+#include <cstdio>
+#include <complex>
+#include <mutex>
+#include <deque>
+#include <map>
+#include <ctime>
+#include <thread>
+#include <condition_variable>
+
+#if __cplusplus >= 201703L
+#define DEBUGPRINTER_CXX17
+#include <optional>
+#include <variant>
+#include <string_view>
+#endif // C++17
+
+#if __cplusplus >= 202002L && (defined(__GNUC__) || defined(__clang__))
+#define DEBUGPRINTER_CXX20
+#endif // C++20
 
 #ifndef DEBUGPRINTER_NO_EXECINFO
 #include <execinfo.h>
@@ -102,11 +171,154 @@
 #define DEBUGPRINTER_DIRSEP '/'
 #endif
 
+#if !defined(DEBUGPRINTER_NO_SIMD) && defined(__GNUC__)                       \
+    && (defined(__x86_64__) || defined(__i386__))
+#define DEBUGPRINTER_SIMD_X86
+#include <immintrin.h>
+#endif
+
+#if !defined(DEBUGPRINTER_NO_TSC) && defined(__GNUC__)                        \
+    && (defined(__x86_64__) || defined(__i386__))
+#define DEBUGPRINTER_TSC
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+#if defined(DEBUGPRINTER_USDT) && !(defined(__linux__) && defined(__GNUC__)     \
+    && (defined(__x86_64__) || defined(__aarch64__)))
+#undef DEBUGPRINTER_USDT
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define DEBUGPRINTER_NO_INSTRUMENT __attribute__((no_instrument_function))
+#else
+#define DEBUGPRINTER_NO_INSTRUMENT
+#endif
+
+#if !defined(DEBUGPRINTER_NO_PERF) && defined(__linux__)
+#define DEBUGPRINTER_PERF
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 #endif // DEBUGPRINTER_OFF
 
 /** \brief General fsc namespace */
 namespace fsc {
 
+/** \brief Range of enum values that are printed by name
+ *  \details Specialise for enums with values outside of the default range
+ *  [`DEBUGPRINTER_ENUM_MIN`, `DEBUGPRINTER_ENUM_MAX`]:
+ *  ~~~{.cpp}
+ *      template <> struct fsc::DebugPrinterEnumRange<Port> {
+ *        static constexpr int min = 8000;
+ *        static constexpr int max = 8100;
+ *      };
+ *  ~~~
+ */
+template <typename E>
+struct DebugPrinterEnumRange {
+  static constexpr int min = DEBUGPRINTER_ENUM_MIN;
+  static constexpr int max = DEBUGPRINTER_ENUM_MAX;
+};
+
+/** \brief Non-owning view of every `stride`-th element of an array
+ *  \details Created by fsc::strided() for dout_SUMMARY and friends, e.g. to
+ *  inspect one component of an array of structs or a matrix column. It is
+ *  also a printable range.
+ */
+template <typename T>
+class StridedView {
+  public:
+  class iterator {
+    public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T *;
+    using reference = const T &;
+
+    iterator(const T * p, const std::ptrdiff_t stride) : p_(p), stride_(stride) {}
+    reference operator*() const { return *p_; }
+    iterator & operator++() { p_ += stride_; return *this; }
+    iterator operator++(int) { iterator res = *this; p_ += stride_; return res; }
+    bool operator==(const iterator & rhs) const { return p_ == rhs.p_; }
+    bool operator!=(const iterator & rhs) const { return p_ != rhs.p_; }
+
+    private:
+    const T * p_;
+    std::ptrdiff_t stride_;
+  };
+
+  StridedView(const T * data, const std::size_t size, const std::ptrdiff_t stride)
+    : data_(data), size_(size), stride_(stride) {}
+
+  const T * data() const noexcept { return data_; }
+  std::size_t size() const noexcept { return size_; }
+  std::ptrdiff_t stride() const noexcept { return stride_; }
+  iterator begin() const { return iterator(data_, stride_); }
+  iterator end() const {
+    return iterator(data_ + static_cast<std::ptrdiff_t>(size_) * stride_, stride_);
+  }
+
+  private:
+  const T * data_;
+  std::size_t size_;
+  std::ptrdiff_t stride_;
+};
+
+/** \brief View of `size` elements of `data`, `stride` elements apart
+ *  \details Example usage:
+ *  ~~~{.cpp}
+ *      dout_SUMMARY(fsc::strided(&matrix[col], rows, cols))  // one column
+ *  ~~~
+ */
+template <typename T>
+StridedView<T> strided(const T * data, const std::size_t size,
+                       const std::ptrdiff_t stride = 1) {
+  return StridedView<T>(data, size, stride);
+}
+
+/** \brief Keep the compiler from discarding a value or computation
+ *  \details The value counts as read by code the optimizer cannot see, and
+ *  all memory as clobbered. Used by dout_BENCH, also handy in hand-written
+ *  timing loops. Example usage:
+ *  ~~~{.cpp}
+ *      for(int i = 0; i < n; ++i)
+ *          fsc::do_not_optimize(std::sqrt(x));
+ *  ~~~
+ */
+template <typename T>
+inline void do_not_optimize(const T & value) noexcept {
+  #if defined(__GNUC__) || defined(__clang__)
+  __asm__ __volatile__("" : : "r,m"(value) : "memory");
+  #else
+  static const void * volatile sink;
+  sink = &value;
+  #endif
+}
+
+/** \brief Keep the compiler from reordering or dropping memory accesses
+ *  \details Pending writes must be done and later reads reloaded, e.g. to
+ *  time stores into a buffer that is never read. Example usage:
+ *  ~~~{.cpp}
+ *      std::fill(buf.begin(), buf.end(), 0);
+ *      fsc::clobber_memory();
+ *  ~~~
+ */
+inline void clobber_memory() noexcept {
+  #if defined(__GNUC__) || defined(__clang__)
+  __asm__ __volatile__("" : : : "memory");
+  #else
+  std::atomic_signal_fence(std::memory_order_acq_rel);
+  #endif
+}
+
 #ifndef DEBUGPRINTER_OFF
 
 /** \brief Class for global static `dout` object
@@ -130,6 +342,24 @@ namespace fsc {
  *      dout_VAL(var)                  // print highlighted 'name = value'
  *      dout_PAUSE()                   // wait for user input (enter key)
  *      dout_PAUSE(x < 10)             // conditionally wait for user input
+ *      dout_SUMMARY(big_vector)       // print min/max/mean/std/NaN count
+ *      dout_HEX(ptr, len)             // print xxd-style hex dump of memory
+ *      dout_CHECK_FINITE(field)       // report NaN/Inf values with stack trace
+ *      dout_DIFF(fast, ref, 1e-9)     // compare two ranges within a tolerance
+ *      dout_HASH(buffer)              // print 64-bit fingerprint of contents
+ *      dout_NPY(field)                // write field to a NumPy .npy file
+ *      dout_ROW("i", i, "res", r)     // append a row to a CSV file per site
+ *      dout_TIMER("solve")            // time the enclosing scope, see report()
+ *      dout_SCOPE("solve")            // same, aggregated into a call tree
+ *      dout_THROUGHPUT("copy", b, n)  // same, with GB/s and items/s
+ *      dout_HIST("queue", q.size())   // histogram with percentiles per site
+ *      dout_COUNT("retry")            // per-thread event counter
+ *      dout_STAT(residual)            // running count/mean/stddev/min/max
+ *      if(dout_BRANCH(n < 16))        // counts true/false, returns bool
+ *      dout_TRIP("axpy n", n)         // distribution of sizes
+ *      dout_PERF("kernel")            // perf_event counters of this scope
+ *      dout_RUSAGE("load")            // page faults, RSS, I/O of this scope
+ *      dout_BENCH(f(x))               // median time per call of an expression
  * 
  * 
  *      // advanced usage (non-exhaustive, check member details):
@@ -146,7 +376,21 @@ namespace fsc {
  *      dout = std::cout               // set output stream
  *      dout.set_precision(13)         // set decimal display precision
  *      dout.set_color("1;34")         // set terminal highlighting color
+ *      dout.set_max_elements(8)       // elide long containers after 8 elements
+ *      dout.report()                  // print dout_TIMER statistics now
+ *      dout.trace_start("trace.json") // record a timeline of dout_SCOPEs
+ *      dout_FLOW(dout.flow_capture()) // carry a flow ID across threads
+ *      dout.set_instrument_filter({"solver::"}) // -finstrument-functions
  *  ~~~
+ *  Containers and ranges, `std::pair`, `std::tuple`, smart pointers and
+ *  `std::chrono::duration` (plus `std::optional` and `std::variant` in C++17)
+ *  are printed even if they have no `operator<<` overload of their own.
+ *  Enums without an `operator<<` of their own are printed as
+ *  `State::Running (2)`, see fsc::DebugPrinterEnumRange.
+ *  In C++17, plain aggregates with up to 16 fields are printed field by field
+ *  as `{1, 2.5}`, and with field names as `{a: 1, b: 2.5}` in C++20 (GCC and
+ *  Clang). Aggregates with base classes, C-array or bit-field members need an
+ *  `operator<<` of their own.
  *  In case the program terminates with `SIGSEGV`, `SIGSYS`, `SIGABRT` or
  *  `SIGFPE`, you will automatically get a stack trace from the raise location.
  *  To turn off this behaviour, check the \link Compilation \endlink section.
@@ -165,6 +409,9 @@ class DebugPrinter {
     operator=(std::cout);
     set_precision(5);
     set_color("0;31");
+    set_max_elements(16);
+    set_max_bytes(1024);
+    set_peak_bandwidth();
 
     #ifndef DEBUGPRINTER_NO_SIGNALS
     struct sigaction act;
@@ -176,6 +423,28 @@ class DebugPrinter {
 
   }
 
+  /// \brief Destructor, hands a running trace over to the exit handler and
+  /// stops the periodic reports of this printer
+  ~DebugPrinter() {
+    {
+      trace_registry & reg = tracing();
+      std::lock_guard<std::mutex> lock(reg.mutex);
+      if(reg.printer == this)
+        reg.printer = nullptr;
+    }
+    profile_registry & reg = profiling();
+    std::unique_lock<std::mutex> lock(reg.mutex);
+    if(reg.interval_printer != this)
+      return;
+    reg.interval = 0;
+    reg.interval_printer = nullptr;
+    reg.wake.notify_all();
+    std::thread t = std::move(reg.ticker);   // waits for a running report
+    lock.unlock();
+    if(t.joinable())
+      t.join();
+  }
+
   /// \brief Deleted copy constructor
   DebugPrinter(const DebugPrinter &) = delete;
 
@@ -234,6 +503,62 @@ class DebugPrinter {
    */
   inline void set_precision(const std::streamsize prec) noexcept { prec_ = prec; }
 
+  /** \brief Number of displayed container elements
+   *  \param n  element budget
+   *  \details Default == 16. Longer ranges print their first and last elements
+   *  around a `... (N more)` marker, so that printing a huge container only
+   *  touches O(n) of its elements (for non-bidirectional ranges without a
+   *  `size()` method, the skipped part still has to be walked). Example usage:
+   *  ~~~{.cpp}
+   *      dout.set_max_elements(4);
+   *      dout_VAL(std::vector<int>(10))  // [0, 0, ... (6 more), 0, 0]
+   *  ~~~
+   */
+  inline void set_max_elements(const std::size_t n) noexcept { max_elem_ = n; }
+  /** \brief Remove container element budget
+   *  \details Print all elements of every container. Example usage:
+   *  ~~~{.cpp}
+   *      dout.set_max_elements();
+   *  ~~~
+   */
+  inline void set_max_elements() noexcept { max_elem_ = 0; }
+
+  /** \brief Number of bytes shown by hex()
+   *  \param n  byte budget
+   *  \details Default == 1024. Longer buffers are shown as the lines covering
+   *  the first and last n/2 bytes. Example usage:
+   *  ~~~{.cpp}
+   *      dout.set_max_bytes(256);
+   *  ~~~
+   */
+  inline void set_max_bytes(const std::size_t n) noexcept { max_bytes_ = n; }
+  /** \brief Remove hex() byte budget
+   *  \details Dump buffers completely. Example usage:
+   *  ~~~{.cpp}
+   *      dout.set_max_bytes();
+   *  ~~~
+   */
+  inline void set_max_bytes() noexcept { max_bytes_ = 0; }
+
+  /** \brief Memory bandwidth that dout_THROUGHPUT reports relate to
+   *  \param gb_per_s  peak bandwidth in GB/s (10^9 bytes per second)
+   *  \details Adds a column with the percentage of the peak to the report.
+   *  Example usage:
+   *  ~~~{.cpp}
+   *      dout.set_peak_bandwidth(25.6);   // DDR4-3200, one channel
+   *  ~~~
+   */
+  inline void set_peak_bandwidth(const double gb_per_s) noexcept {
+    peak_gbs_ = gb_per_s;
+  }
+  /** \brief Remove the peak bandwidth
+   *  \details Default. Example usage:
+   *  ~~~{.cpp}
+   *      dout.set_peak_bandwidth();
+   *  ~~~
+   */
+  inline void set_peak_bandwidth() noexcept { peak_gbs_ = 0; }
+
   /** \brief Highlighting color
    *  \param str  color code
    *  \details
@@ -283,7 +608,7 @@ class DebugPrinter {
   template <typename T, typename U>
   inline void operator()(const T & label, U const & obj,
                          const std::string sc = ": ") const {
-    print_stream_impl< has_stream<T> && has_stream<U> >(label, obj, sc);
+    print_stream_impl< is_printable<T>() && is_printable<U>() >(label, obj, sc);
   }
   /** \brief Print highlighted object
    *  \param obj    should have a std::ostream & operator<< overload
@@ -343,8 +668,8 @@ class DebugPrinter {
     char ** symbols = backtrace_symbols(stack, end);
 
     if(compact == false)
-      out << "DebugPrinter obtained " << end-begin << " stack frames:"
-          << std::endl;
+      line_start() << "DebugPrinter obtained " << end-begin << " stack frames:"
+                   << std::endl;
     if(!symbols) return;
 
     #ifndef DEBUGPRINTER_NO_CXXABI
@@ -375,7 +700,7 @@ class DebugPrinter {
             out << "  " << prog << ":  " << demangled << "\t+"
                 << offset << "\t[+" << mainoffset << "]"<< std::endl;
           else
-            out << demangled << std::endl;
+            line_start() << demangled << std::endl;
       }
     }
     if(compact == false) out << std::endl;
@@ -386,7 +711,7 @@ class DebugPrinter {
       if(compact == false)
         out << "  " << symbols[i] << std::endl;
       else
-        out << mangled_part(std::string(symbols[i])) << std::endl;
+        line_start() << mangled_part(std::string(symbols[i])) << std::endl;
     }
 
     if(compact == false) out << std::endl;
@@ -404,11 +729,592 @@ class DebugPrinter {
   #else // DEBUGPRINTER_NO_EXECINFO
 
   void stack(...) const {
-    *outstream << "DebugPrinter::stack() not available" << std::endl;
+    line_start() << "DebugPrinter::stack() not available" << std::endl;
   }
 
   #endif // DEBUGPRINTER_NO_EXECINFO
 
+/*******************************************************************************
+ * DebugPrinter numeric inspection
+ */
+
+  /** \brief Print statistics of a numeric range
+   *  \param label  printed in front of the statistics
+   *  \param range  range of arithmetic values
+   *  \details Prints the element count, minimum and maximum (with the index
+   *  of their first occurrence), mean and standard deviation of the finite
+   *  values, and the number of NaN, infinite and zero values. Contiguous
+   *  ranges of `float`, `double` and integers up to 32 bits are scanned in a
+   *  single vectorised pass (SSE2/AVX2/AVX-512, chosen at runtime), other
+   *  ranges and fsc::StridedView use a scalar pass. Example usage:
+   *  ~~~{.cpp}
+   *      dout.summary("field", field);
+   *      dout.summary("x", fsc::strided(&xyz[0], n, 3));  // every third
+   *      dout_SUMMARY(field)                             // shortcut
+   *  ~~~
+   */
+  template <typename R>
+  void summary(const std::string & label, const R & range) const {
+    static_assert(std::is_arithmetic<range_value_t<R>>::value,
+                  "DebugPrinter error: summary() needs a numeric range");
+    const auto acc = summarize(range, typename is_contiguous_impl<R>::type());
+    const double n = static_cast<double>(acc.finite);
+    const double mean = acc.finite ? acc.shift + acc.sum / n : 0;
+    const double var = acc.finite ? (acc.sum2 - acc.sum * acc.sum / n) / n : 0;
+    // Integers are scanned as double by the vectorised pass, print them exact
+    using T = std::remove_cv_t<range_value_t<R>>;
+    using V = std::conditional_t<std::is_integral<T>::value, T,
+                                 std::remove_cv_t<decltype(acc.min)>>;
+
+    std::ostream & out = line_start();
+    std::streamsize savep = out.precision(prec_);
+    out << hcol_ << label << ": " << hcol_r_ << "n=" << acc.count;
+    if(acc.finite != 0)
+      out << "  min=" << +static_cast<V>(acc.min) << " @" << acc.argmin
+          << "  max=" << +static_cast<V>(acc.max) << " @" << acc.argmax
+          << "  mean=" << mean << "  std=" << std::sqrt(std::max(var, 0.));
+    out << "  nan=" << acc.nan << "  inf=" << acc.inf
+        << "  zero=" << acc.zero << std::endl;
+    out.precision(savep);
+  }
+
+  /** \brief Check a floating point range for NaN and infinite values
+   *  \param label  printed in front of the report
+   *  \param range  range of floating point values
+   *  \return true if all values are finite
+   *  \details Silent if all values are finite. Otherwise prints the number of
+   *  non-finite values, the index and value of the first one, and a stack
+   *  trace like stack(). Contiguous ranges of `float` and `double` are scanned
+   *  in a vectorised pass (SSE2/AVX2/AVX-512, chosen at runtime) that only
+   *  looks closer at blocks containing an offender. Example usage:
+   *  ~~~{.cpp}
+   *      dout.check_finite("field", field);
+   *      dout_CHECK_FINITE(field)                            // shortcut
+   *  ~~~
+   */
+  template <typename R>
+  bool check_finite(const std::string & label, const R & range) const {
+    static_assert(std::is_floating_point<range_value_t<R>>::value,
+                  "DebugPrinter error: check_finite() needs a floating point range");
+    finite_acc acc;
+    scan_finite(range, acc, typename is_contiguous_impl<R>::type());
+    return report_finite(label, acc);
+  }
+  /** \brief Check projected values of a range for NaN and infinite values
+   *  \param label  printed in front of the report
+   *  \param range  range of arbitrary elements
+   *  \param proj   callable returning a floating point value for an element
+   *  \return true if all projected values are finite
+   *  \details Like check_finite(label, range), with a scalar pass over
+   *  `proj(element)`. Example usage:
+   *  ~~~{.cpp}
+   *      dout.check_finite("vx", particles, [](const Particle & p) { return p.vx; });
+   *      dout_CHECK_FINITE(particles, [](const Particle & p) { return p.vx; })
+   *  ~~~
+   */
+  template <typename R, typename P>
+  bool check_finite(const std::string & label, const R & range, P proj) const {
+    static_assert(std::is_floating_point<std::decay_t<decltype(
+                    proj(*std::begin(range)))>>::value,
+                  "DebugPrinter error: check_finite() projection must return a "
+                  "floating point value");
+    finite_acc acc;
+    std::size_t i = 0;
+    for(const auto & e : range)
+      acc.add(proj(e), i++);
+    acc.count = i;
+    return report_finite(label, acc);
+  }
+
+  /** \brief Compare two numeric ranges within a tolerance
+   *  \param label  printed in front of the report
+   *  \param a      range of arithmetic values (tested)
+   *  \param b      range of arithmetic values (reference)
+   *  \param atol   absolute tolerance
+   *  \param rtol   tolerance relative to |b|
+   *  \return number of mismatches (including surplus elements of the longer
+   *  range)
+   *  \details Values match if `a == b` or `|a - b| <= atol + rtol * |b|`, NaN
+   *  never matches. Prints the number of mismatches, the largest absolute and
+   *  relative error with their index, and the first mismatching values with
+   *  their difference (up to the set_max_elements() budget). Contiguous ranges
+   *  of `float`, `double` and integers up to 32 bits are compared in a
+   *  vectorised pass, nothing is allocated. Example usage:
+   *  ~~~{.cpp}
+   *      dout.diff("fast vs ref", fast, ref, 1e-12, 1e-9);
+   *      dout_DIFF(fast, ref, 1e-12)                      // shortcut
+   *  ~~~
+   */
+  template <typename A, typename B>
+  std::size_t diff(const std::string & label, const A & a, const B & b,
+                   const double atol = 0, const double rtol = 0) const {
+    using T = range_value_t<A>;
+    using U = range_value_t<B>;
+    static_assert(std::is_arithmetic<T>::value && std::is_arithmetic<U>::value,
+                  "DebugPrinter error: diff() needs numeric ranges");
+    using C = diff_compute_t<T, U>;
+    const std::size_t na = range_size(a, typename has_size_impl<A>::type());
+    const std::size_t nb = range_size(b, typename has_size_impl<B>::type());
+    const std::size_t n = std::min(na, nb);
+    const C ca = static_cast<C>(atol), cr = static_cast<C>(rtol);
+
+    diff_acc acc;
+    diff_scan(a, b, n, ca, cr, acc, std::integral_constant<bool,
+              is_flat<A>::value && is_flat<B>::value>());
+
+    std::ostream & out = line_start();
+    std::streamsize savep = out.precision(prec_);
+    out << hcol_ << label << ": " << hcol_r_ << acc.bad << " of " << n
+        << " differ  max abs=" << acc.maxabs << " @" << acc.iabs
+        << "  max rel=" << acc.maxrel << " @" << acc.irel
+        << "  (atol=" << atol << " rtol=" << rtol << ")";
+    if(na != nb)
+      out << "  size " << na << " vs " << nb;
+    out << std::endl;
+    if(acc.bad != 0)
+      diff_list(out, std::begin(a), std::begin(b), n, acc, ca, cr);
+    out.precision(savep);
+    return acc.bad + std::max(na, nb) - n;
+  }
+
+  /** \brief Print a 64-bit fingerprint of a buffer or object
+   *  \param label  printed in front of the fingerprint
+   *  \param obj    range of trivially copyable values, or trivially copyable
+   *                object
+   *  \return the fingerprint
+   *  \details Hashes the bytes of the elements (or of the object, including
+   *  padding bytes) with a fast non-cryptographic hash, vectorised for
+   *  contiguous ranges. Equal element bytes give equal fingerprints
+   *  regardless of the container. Example usage:
+   *  ~~~{.cpp}
+   *      dout.hash("grid", grid);
+   *      dout_HASH(grid)                             // shortcut
+   *      dout_HASH_CHANGED(grid)                     // only print changes
+   *  ~~~
+   */
+  template <typename T>
+  std::uint64_t hash(const std::string & label, const T & obj) const {
+    const std::uint64_t h = fingerprint(obj);
+    print_hash(label, h, hash_bytes(obj));
+    return h;
+  }
+  /** \brief Print a fingerprint if it differs from the last one
+   *  \param label  printed in front of the fingerprint
+   *  \param obj    see hash()
+   *  \param last   last fingerprint, updated
+   *  \param seen   false before the first call, set
+   *  \return true if the fingerprint changed
+   *  \details The first call always prints. Example usage:
+   *  ~~~{.cpp}
+   *      static std::atomic<std::uint64_t> last(0);
+   *      static std::atomic<bool> seen(false);
+   *      dout.hash_changed("grid", grid, last, seen);
+   *      dout_HASH_CHANGED(grid)                     // shortcut
+   *  ~~~
+   */
+  template <typename T>
+  bool hash_changed(const std::string & label, const T & obj,
+                    std::atomic<std::uint64_t> & last,
+                    std::atomic<bool> & seen) const {
+    const std::uint64_t h = fingerprint(obj);
+    const bool first = !seen.exchange(true, std::memory_order_relaxed);
+    if(last.exchange(h, std::memory_order_relaxed) == h && !first)
+      return false;
+    print_hash(label, h, hash_bytes(obj));
+    return true;
+  }
+
+  /** \brief Print a hex dump of a memory region
+   *  \param label  printed in front of the dump
+   *  \param data   start of the memory region
+   *  \param size   number of bytes
+   *  \param group  bytes per column: 1, 2, 4, 8 or 16
+   *  \details Prints the `xxd` layout, e.g.
+   *  ~~~
+   *      00000000: 4865 6c6c 6f20 576f 726c 640a            Hello World.
+   *  ~~~
+   *  The lines are built directly in a buffer (hex digits via SSSE3 shuffles
+   *  when available) that is written to the stream in large chunks. Buffers
+   *  longer than set_max_bytes() only show their first and last lines.
+   *  Example usage:
+   *  ~~~{.cpp}
+   *      dout.hex("frame", frame.data(), frame.size());
+   *      dout_HEX(frame.data(), frame.size())            // shortcut
+   *  ~~~
+   */
+  void hex(const std::string & label, const void * data, const std::size_t size,
+           const unsigned group = 2) const {
+    if(group == 0 || group > 16 || (group & (group - 1)) != 0)
+      throw std::runtime_error("DebugPrinter error: invalid hex() group size");
+    std::ostream & out = line_start();
+    out << hcol_ << label << ": " << hcol_r_ << size << " bytes at " << data
+        << std::endl;
+
+    const unsigned char * bytes = static_cast<const unsigned char *>(data);
+    std::size_t head = size, tail = size;           // [head, tail) is skipped
+    if(max_bytes_ != 0 && size > max_bytes_) {
+      head = (max_bytes_ / 2 + 15) / 16 * 16;
+      tail = std::max(head, (size - max_bytes_ / 2) / 16 * 16);
+    }
+
+    char buf[64 * hex_line_max];
+    std::size_t pos = 0;
+    for(std::size_t off = 0; off < size; off += 16) {
+      if(off == head && tail > head) {
+        out.write(buf, static_cast<std::streamsize>(pos));
+        pos = 0;
+        out << "... (" << tail - head << " bytes)" << std::endl;
+        off = tail;
+        if(off >= size) break;
+      }
+      pos += hex_line(buf + pos, bytes + off, std::min<std::size_t>(16, size - off),
+                      off, group);
+      if(pos > sizeof(buf) - hex_line_max) {
+        out.write(buf, static_cast<std::streamsize>(pos));
+        pos = 0;
+      }
+    }
+    out.write(buf, static_cast<std::streamsize>(pos));
+    out.flush();
+  }
+
+/*******************************************************************************
+ * DebugPrinter array dumps
+ */
+
+  /** \brief Write a numeric range to a NumPy `.npy` file
+   *  \param path   file name
+   *  \param range  range of arithmetic or std::complex values
+   *  \param shape  optional array shape (row-major), its product must be the
+   *                number of elements
+   *  \return true if the file was written
+   *  \details Writes the `.npy` header (version 1.0) followed by the raw
+   *  elements: contiguous ranges in a single `fwrite`, other ranges in large
+   *  chunks. Prints one line with the path, dtype, shape and size. Example
+   *  usage:
+   *  ~~~{.cpp}
+   *      dout.npy("rho.npy", rho, {nx, ny, nz});
+   *      dout_NPY(rho)                          // <file>_<line>_<hit>.npy
+   *  ~~~
+   *  Load with `numpy.load("rho.npy")`.
+   */
+  template <typename R>
+  bool npy(const std::string & path, const R & range,
+           const std::initializer_list<std::size_t> shape = {}) const {
+    using T = range_value_t<R>;
+    static_assert(std::is_arithmetic<T>::value || is_complex<T>::value,
+                  "DebugPrinter error: npy() needs a numeric range");
+    const std::size_t n = range_size(range, typename has_size_impl<R>::type());
+    std::size_t total = 1;
+    for(std::size_t d : shape) total *= d;
+    if(shape.size() != 0 && total != n)
+      throw std::runtime_error("DebugPrinter error: npy() shape does not "
+                               "match the range size");
+
+    std::string dims = "(";
+    if(shape.size() == 0)
+      dims += std::to_string(n) + ",";
+    for(std::size_t d : shape)
+      dims += (dims.size() == 1 ? "" : ", ") + std::to_string(d);
+    if(shape.size() == 1) dims += ",";
+    dims += ")";
+    const std::string descr = npy_descr(static_cast<T *>(nullptr));
+
+    std::unique_ptr<std::FILE, int (*)(std::FILE *)> file(
+      std::fopen(path.c_str(), "wb"), &std::fclose);
+    const std::string header = npy_header("'" + descr + "'", dims);
+    bool ok = file && std::fwrite(header.data(), 1, header.size(), file.get())
+                      == header.size();
+    if(ok)
+      ok = npy_write(file.get(), range, n,
+                     std::integral_constant<bool, is_flat<R>::value>());
+    if(file && std::fclose(file.release()) != 0)
+      ok = false;
+
+    std::ostream & out = line_start();
+    if(!ok) {
+      out << "DebugPrinter error: could not write " << path << std::endl;
+      return false;
+    }
+    out << hcol_ << path << ": " << hcol_r_ << descr << " " << dims << " "
+        << n * sizeof(T) << " bytes" << std::endl;
+    return true;
+  }
+
+/*******************************************************************************
+ * DebugPrinter profiling
+ */
+
+  /** \brief Print the statistics of all profiling sites
+   *  \details Prints one table per kind of site (e.g. all `dout_TIMER`s), with
+   *  the data of all threads merged. Called automatically at program exit
+   *  through the `dout` object that registered the first site, see
+   *  set_report_at_exit(). Example usage:
+   *  ~~~{.cpp}
+   *      dout.report();
+   *  ~~~
+   */
+  void report() const {
+    profile_registry & reg = profiling();
+    std::vector<void (*)(const DebugPrinter &)> reporters;
+    {
+      std::lock_guard<std::mutex> lock(reg.mutex);
+      reporters = reg.reporters;
+    }
+    for(auto rep : reporters)
+      rep(*this);
+    if(instrument_ready().load(std::memory_order_acquire))
+      instrument_report(*this);
+  }
+
+  /** \brief Print report() at program exit
+   *  \param on  default == true
+   *  \details Applies to all DebugPrinter objects. Example usage:
+   *  ~~~{.cpp}
+   *      dout.set_report_at_exit(false);
+   *  ~~~
+   */
+  void set_report_at_exit(const bool on = true) const noexcept {
+    profiling().at_exit = on;
+  }
+
+  /** \brief Print report() periodically from a background thread
+   *  \param seconds  interval, default == 0 stops the reports
+   *  \details The reports go to this DebugPrinter. The thread is stopped at
+   *  program exit. Example usage:
+   *  ~~~{.cpp}
+   *      dout.set_report_interval(10);
+   *  ~~~
+   */
+  void set_report_interval(const double seconds = 0) const {
+    profile_registry & reg = profiling();
+    std::unique_lock<std::mutex> lock(reg.mutex);
+    reg.interval = seconds > 0 ? seconds : 0;
+    reg.interval_printer = this;
+    reg.wake.notify_all();
+    if(reg.interval > 0 && !reg.ticker.joinable())
+      reg.ticker = std::thread(&report_periodically);
+    else if(reg.interval == 0 && reg.ticker.joinable()) {
+      std::thread t = std::move(reg.ticker);
+      lock.unlock();
+      t.join();
+    }
+  }
+
+  /** \brief Start recording a timeline of the profiling sites
+   *  \param path  Chrome Trace Event JSON file written by trace_stop()
+   *  \details Records the begin and end of every dout_SCOPE, dout_HERE,
+   *  dout_TRACE_INSTANT and dout_TRACE_COUNTER events of all threads, with
+   *  time stamps of the profiling clock, into per-thread buffers of up to 16M
+   *  events per trace (the buffers are reused by the next trace). The file
+   *  opens in chrome://tracing and ui.perfetto.dev. A trace that is still
+   *  running at program exit is written then. Example usage:
+   *  ~~~{.cpp}
+   *      dout.trace_start("trace.json");
+   *  ~~~
+   */
+  void trace_start(const std::string & path) const {
+    profiling();                                 // write at exit
+    trace_registry & reg = tracing();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.path = path;
+    reg.printer = this;
+    if(trace_on().load(std::memory_order_relaxed)) return;
+    reg.erase_exited();
+    trace_generation().fetch_add(1, std::memory_order_release);
+    tick_clock::overhead();                      // calibrate before first use
+    instrument_trace(true);
+    reg.start = tick_clock::now();
+    trace_on().store(true, std::memory_order_release);
+  }
+
+  /** \brief Stop recording and write the timeline of trace_start()
+   *  \return false if no trace was running or the file could not be written
+   *  \details Prints the path, the number of events and of those dropped
+   *  because the buffer of their thread was full. Example usage:
+   *  ~~~{.cpp}
+   *      dout.trace_stop();
+   *  ~~~
+   */
+  bool trace_stop() const {
+    trace_registry & reg = tracing();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    if(!trace_on().exchange(false)) return false;
+    std::ostream & out = *outstream;
+    std::size_t events = 0, dropped = 0;
+    const bool ok = reg.write(events, dropped);
+    instrument_trace(false);
+    reg.erase_exited();
+    if(!ok) {
+      out << "DebugPrinter error: could not write " << reg.path << std::endl;
+      return false;
+    }
+    out << hcol_ << reg.path << ": " << hcol_r_ << events << " events";
+    if(dropped != 0)
+      out << ", " << dropped << " dropped (thread buffer full)";
+    out << std::endl;
+    return true;
+  }
+
+  /** \brief Flow ID of the calling thread
+   *  \return 0 if none
+   *  \details Lines printed by `dout(...)`, `dout_VAL`, dout_SUMMARY,
+   *  dout_HEX, dout_DIFF, dout_HASH, dout_CHECK_FINITE, dout_NPY, dout_BENCH
+   *  and stack() are prefixed with `[flow ID]` (multi-line output on its
+   *  first line only, not the output of `dout << ...`), and trace events
+   *  carry it. Set with
+   *  set_flow(), flow_capture() or dout_FLOW. Example usage:
+   *  ~~~{.cpp}
+   *      std::uint64_t id = dout.flow();
+   *  ~~~
+   */
+  std::uint64_t flow() const noexcept { return flow_local(); }
+
+  /** \brief Set the flow ID of the calling thread
+   *  \param id  e.g. a request number, default == 0 clears the ID
+   *  \details Example usage:
+   *  ~~~{.cpp}
+   *      dout.set_flow(request.id);
+   *  ~~~
+   */
+  void set_flow(const std::uint64_t id = 0) const noexcept { flow_local() = id; }
+
+  /** \brief Flow ID to hand over to asynchronous work
+   *  \return the flow ID of the calling thread, a new one if it has none
+   *  \details Pass the ID along with the work and restore it with dout_FLOW
+   *  where the work runs. A new ID is not set for the calling thread, so
+   *  every capture outside of a flow starts a flow of its own. Between
+   *  trace_start() and trace_stop(), this marks the start of an arrow to the
+   *  dout_FLOW of the same ID. Example usage:
+   *  ~~~{.cpp}
+   *      pool.submit([id = dout.flow_capture()] {
+   *          dout_FLOW(id)
+   *          // ...
+   *      });
+   *  ~~~
+   */
+  std::uint64_t flow_capture() const {
+    std::uint64_t id = flow_local();
+    if(id == 0) {
+      static std::atomic<std::uint64_t> next{1};
+      id = next.fetch_add(1, std::memory_order_relaxed);
+    }
+    if(trace_on().load(std::memory_order_relaxed)) {
+      trace_buffer & b = trace_local();
+      b.append('B', trace_flow_name(), 0, id);
+      b.append('s', trace_flow_name(), 0, id);
+      b.append('E', trace_flow_name(), 0, id);
+    }
+    return id;
+  }
+
+  /** \brief Select the functions shown for `DEBUGPRINTER_INSTRUMENT`
+   *  \param include  show only functions whose demangled name or module path
+   *                   contains one of these, all if empty
+   *  \param exclude  hide functions matching one of these, their callees
+   *                   move up to the caller
+   *  \details With `DEBUGPRINTER_INSTRUMENT` defined in one translation unit,
+   *  every call of a function compiled with `-finstrument-functions` is
+   *  logged by address and time stamp into a buffer of its thread. report()
+   *  shows them as a call tree like dout_SCOPE (module instead of
+   *  file:line) and trace_stop() adds them to the timeline. Addresses are
+   *  resolved only there, once per function, through the stack()
+   *  symbolizer, so link with `-rdynamic`; unresolved functions show their
+   *  address. The filter applies to all calls recorded so far. Exclude this
+   *  header and the standard library from the instrumentation with
+   *  `-finstrument-functions-exclude-file-list=fsc/DebugPrinter.hpp,/include/c++/`.
+   *  Example usage:
+   *  ~~~{.cpp}
+   *      dout.set_instrument_filter({"solver::"}, {"operator[]"});
+   *  ~~~
+   */
+  void set_instrument_filter(const std::vector<std::string> & include,
+                             const std::vector<std::string> & exclude = {}) const {
+    instrument_registry & reg = instrumenting();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.include = include;
+    reg.exclude = exclude;
+    for(instrument_fn & f : reg.fns)
+      f.on = reg.match(f.key);
+  }
+
+  /** \brief Pause or resume the recording of `DEBUGPRINTER_INSTRUMENT`
+   *  \param on  default == true
+   *  \details Example usage:
+   *  ~~~{.cpp}
+   *      dout.set_instrument(false);
+   *  ~~~
+   */
+  void set_instrument(const bool on = true) const noexcept {
+    instrument_on().store(on, std::memory_order_relaxed);
+  }
+
+  /** \brief Time a callable in a microbenchmark loop
+   *  \param label    printed in front of the result
+   *  \param f        callable without arguments, its result is kept alive
+   *                  with fsc::do_not_optimize()
+   *  \param seconds  time budget, default == 1
+   *  \return median time per call in ns
+   *  \details Doubles the batch size until a batch takes 200 us (one call if
+   *  longer), warms up for a tenth of the budget (at most 50 ms), then times
+   *  batches until the 95% confidence interval of the median is within 1% of
+   *  it or the budget is spent. Prints the median, the interval, the number
+   *  of batches and calls per batch, and "noisy" if the interval did not
+   *  narrow down. Variables captured by reference are reloaded for every
+   *  call. Example usage:
+   *  ~~~{.cpp}
+   *      dout.bench("norm", [&] { return norm(v); });
+   *      dout_BENCH(norm(v))                           // shortcut
+   *  ~~~
+   */
+  template <typename F>
+  double bench(const std::string & label, F && f, const double seconds = 1) const {
+    using void_result = std::is_void<decltype(f())>;
+    do_not_optimize(f);                          // captures escape
+    tick_clock::overhead();                      // calibrate before first use
+    const double scale = tick_clock::ns_per_tick();
+    const auto batch = [&](const std::uint64_t n) {
+      const std::uint64_t t0 = tick_clock::now();
+      for(std::uint64_t i = 0; i < n; ++i)
+        bench_call(f, void_result());
+      return static_cast<double>(tick_clock::elapsed(t0, tick_clock::now())) * scale;
+    };
+
+    const std::uint64_t start = tick_clock::steady_ns();
+    const double budget = std::max(seconds, 0.) * 1e9;
+    const double target = 200e3;
+    std::uint64_t n = 1;
+    double t = batch(n);
+    for(; t < target && n < (std::uint64_t(1) << 40); t = batch(n))
+      n *= 2;
+    if(t > target)
+      n = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(
+            static_cast<double>(n) * target / t));
+    while(static_cast<double>(tick_clock::steady_ns() - start)
+          < std::min(budget / 10, 50e6))
+      batch(n);
+
+    std::vector<double> ns;
+    bench_stats st;
+    do {
+      ns.push_back(batch(n) / static_cast<double>(n));
+      if(ns.size() >= 10 && ns.size() % 5 == 0) {
+        st = bench_median(ns);
+        if(st.hi - st.lo <= 0.02 * st.median) break;
+      }
+    } while(static_cast<double>(tick_clock::steady_ns() - start) < budget);
+    st = bench_median(ns);
+
+    std::ostream & out = line_start();
+    out << hcol_ << label << ": " << hcol_r_ << format_ns(st.median)
+        << "/op  95% [" << format_ns(st.lo) << ", " << format_ns(st.hi)
+        << "]  " << ns.size() << " x " << n << " calls";
+    if(ns.size() < 10 || st.hi - st.lo > 0.02 * st.median)
+      out << "  noisy";
+    out << std::endl;
+    return st.median;
+  }
+
 /*******************************************************************************
  * DebugPrinter "private" parts
  */
@@ -421,6 +1327,10 @@ class DebugPrinter {
     // Simulate method specialisation through overloading
     template<typename T> struct fwdtype {};
 
+    // Object as printed by dout_VAL, argument of the USDT probes
+    template <typename T>
+    std::string text(const T & obj) const { return super.text(obj); }
+
     // Specialisation for type printing, used through dout_TYPE and dout_TYPE_OF
     #define DEBUGPRINTER_TYPE_SPEC(mods)                                       \
     template <typename T>                                                      \
@@ -484,50 +1394,529 @@ class DebugPrinter {
       return str.substr(str.rfind(DEBUGPRINTER_DIRSEP)+1);
     }
 
-  } const detail_{*this};
-  /// \endcond
+    // dout_ROW: per-site buffer of packed binary rows, flushed when full and
+    // at exit. Written as CSV, or as a .npy structured array (one named field
+    // per column) if the path ends in ".npy".
+    class row_sink {
+      public:
+        row_sink(const DebugPrinter & d, const char * file, const int line,
+                 std::string path = "", const std::size_t capacity = 1 << 20)
+          : super_(d), path_(path), capacity_(capacity) {
+          if(path_.empty()) {
+            path_ = d.detail_.filemacro_name(file);
+            path_ = path_.substr(0, path_.rfind('.')) + "_"
+                  + std::to_string(line) + ".csv";
+          }
+          npy_ = path_.size() > 4 && path_.compare(path_.size() - 4, 4, ".npy") == 0;
+        }
+        row_sink(const row_sink &) = delete;
+        row_sink & operator=(const row_sink &) = delete;
+        ~row_sink() {
+          std::lock_guard<std::mutex> lock(mutex_);
+          flush();
+          if(npy_ && file_.is_open()) {          // final row count
+            file_.seekp(0);
+            file_ << npy_header(descr(), "(" + std::to_string(rows_) + ",)",
+                                header_size_);
+          }
+        }
 
-/*******************************************************************************
- * DebugPrinter private parts
- */
+        template <typename... T>
+        void append(const T &... args) {
+          static_assert(sizeof...(T) % 2 == 0,
+                        "DebugPrinter error: dout_ROW needs name, value pairs");
+          std::lock_guard<std::mutex> lock(mutex_);
+          if(buf_.empty()) open(args...);
+          if(capacity_ - fill_ < row_size_) flush();
+          put(args...);
+          ++rows_;
+        }
 
-  private:
+      private:
+        struct column {
+          std::string name, descr;
+          std::size_t size;
+          void (*print)(std::ostream &, const unsigned char *);
+        };
 
-  std::ostream * outstream;                      // output stream
-  std::shared_ptr<std::ostream> outstream_mm;    // managed output stream
-  std::streamsize prec_;                         // precision
-  std::string hcol_;                             // highlighting color
-  std::string hcol_r_;                           // neutral color
+        template <typename T>
+        static void print_value(std::ostream & os, const unsigned char * p) {
+          T x;
+          std::memcpy(&x, p, sizeof x);
+          os << std::setprecision(std::numeric_limits<T>::max_digits10) << +x;
+        }
 
-  static const unsigned int max_backtrace = 50;
-  static const unsigned int max_demangled = 4096;
+        void describe() noexcept {}
+        template <typename T, typename... R>
+        void describe(const char * name, const T &, const R &... rest) {
+          static_assert(std::is_arithmetic<T>::value,
+                        "DebugPrinter error: dout_ROW values must be numbers");
+          cols_.push_back({name, npy_descr(static_cast<T *>(nullptr)),
+                           sizeof(T), &print_value<T>});
+          row_size_ += sizeof(T);
+          describe(rest...);
+        }
 
-  #ifndef DEBUGPRINTER_NO_SIGNALS
-  using sig_type = int;
-  static std::map<sig_type, std::string> sig_names() {
-    std::map<sig_type, std::string> res;
-    res[SIGABRT] = "SIGABRT";
-    res[SIGFPE] = "SIGFPE";
-    res[SIGSEGV] = "SIGSEGV";
-    res[SIGSYS] = "SIGSYS";
-    return res;
-  }
-  //~ static DebugPrinter & static_init() { static DebugPrinter d; return d; }
-  static void signal_handler(int signum) {
-    static DebugPrinter d;
-    d << "DebugPrinter handler caught signal "
-      << sig_names()[signum] << " (" << signum << ")" << std::endl;
-    //~ static_init().stack(max_backtrace, false, 3);
-    d.stack(max_backtrace, false, 3);
-    struct sigaction act;
-    act.sa_handler = SIG_DFL;
-    sigaction(signum, &act, NULL);
+        void put() noexcept {}
+        template <typename T, typename... R>
+        void put(const char *, const T & value, const R &... rest) noexcept {
+          std::memcpy(buf_.data() + fill_, &value, sizeof value);
+          fill_ += sizeof value;
+          put(rest...);
+        }
+
+        std::string descr() const {
+          std::string d = "[";
+          for(const column & c : cols_)
+            d += "('" + c.name + "', '" + c.descr + "'), ";
+          return d + "]";
+        }
+
+        template <typename... T>
+        void open(const T &... args) {
+          describe(args...);
+          capacity_ = std::max(capacity_, row_size_);
+          buf_.resize(capacity_);
+          file_.open(path_, std::ios::binary);
+          if(npy_) {                             // room for any row count
+            const std::string header = npy_header(descr(), "(" +
+              std::string(std::numeric_limits<std::size_t>::digits10 + 1, ' ') + ",)");
+            header_size_ = header.size();
+            file_ << header;
+          } else {
+            for(std::size_t i = 0; i < cols_.size(); ++i)
+              file_ << (i == 0 ? "" : ",") << cols_[i].name;
+            file_ << '\n';
+          }
+          std::ostream & out = *super_.outstream;
+          out << super_.hcol_ << path_ << ": " << super_.hcol_r_;
+          for(std::size_t i = 0; i < cols_.size(); ++i)
+            out << (i == 0 ? "" : ", ") << cols_[i].name;
+          out << (file_ ? "" : "  DebugPrinter error: could not open file")
+              << std::endl;
+        }
+
+        void flush() {
+          if(npy_) {
+            file_.write(reinterpret_cast<const char *>(buf_.data()),
+                        static_cast<std::streamsize>(fill_));
+          } else {
+            for(std::size_t pos = 0; pos < fill_; file_ << '\n') {
+              for(std::size_t i = 0; i < cols_.size(); ++i) {
+                if(i != 0) file_ << ',';
+                cols_[i].print(file_, buf_.data() + pos);
+                pos += cols_[i].size;
+              }
+            }
+          }
+          file_.flush();
+          fill_ = 0;
+        }
+
+        const DebugPrinter & super_;
+        std::string path_;
+        std::size_t capacity_, fill_ = 0, row_size_ = 0, rows_ = 0;
+        std::size_t header_size_ = 0;
+        bool npy_;
+        std::vector<column> cols_;
+        std::vector<unsigned char> buf_;
+        std::ofstream file_;
+        std::mutex mutex_;
+    };
+
+    // dout_TIMER: one timer_site per use site, one timer per pass
+    class timer_site {
+      public:
+        timer_site(const DebugPrinter & d, const std::string & label,
+                   const char * file, const int line, const bool cpu)
+          : id_(site_table<timer_slot>::instance().add(d, label, file, line)),
+            cpu_(cpu) {
+          tick_clock::overhead();                // calibrate before first use
+        }
+        void record(const std::uint64_t ticks, const std::uint64_t cpu_ns) {
+          site_table<timer_slot>::instance().local(id_).record(ticks, cpu_ns);
+        }
+        bool cpu() const noexcept { return cpu_; }
+      private:
+        const std::size_t id_;
+        const bool cpu_;
+    };
+
+    class timer {
+      public:
+        explicit timer(timer_site & site) noexcept
+          : site_(site), cpu_(site.cpu() ? thread_cpu_ns() : 0),
+            start_(tick_clock::now()) {}
+        ~timer() {
+          const std::uint64_t stop = tick_clock::now();
+          const std::uint64_t cpu = site_.cpu() ? thread_cpu_ns() - cpu_ : 0;
+          site_.record(tick_clock::elapsed(start_, stop), cpu);
+        }
+        timer(const timer &) = delete;
+        timer & operator=(const timer &) = delete;
+      private:
+        timer_site & site_;
+        const std::uint64_t cpu_, start_;
+    };
+
+    // dout_THROUGHPUT
+    class throughput_site {
+      public:
+        throughput_site(const DebugPrinter & d, const std::string & label,
+                        const char * file, const int line)
+          : id_(site_table<throughput_slot>::instance().add(d, label, file, line)) {
+          tick_clock::overhead();                // calibrate before first use
+        }
+        void record(const std::uint64_t ticks, const std::uint64_t bytes,
+                    const std::uint64_t items) const {
+          site_table<throughput_slot>::instance().local(id_).record(ticks, bytes, items);
+        }
+      private:
+        const std::size_t id_;
+    };
+
+    class throughput {
+      public:
+        throughput(const throughput_site & site, const std::uint64_t bytes,
+                   const std::uint64_t items) noexcept
+          : site_(site), bytes_(bytes), items_(items), start_(tick_clock::now()) {}
+        ~throughput() {
+          const std::uint64_t stop = tick_clock::now();
+          site_.record(tick_clock::elapsed(start_, stop), bytes_, items_);
+        }
+        throughput(const throughput &) = delete;
+        throughput & operator=(const throughput &) = delete;
+      private:
+        const throughput_site & site_;
+        const std::uint64_t bytes_, items_, start_;
+    };
+
+    // dout_SCOPE: one scope_site per use site, one scope per pass
+    class scope_site {
+      public:
+        scope_site(const DebugPrinter & d, const std::string & label,
+                   const char * file, const int line)
+          : id_(scope_tree::instance().add(d, label, file, line)),
+            trace_(trace_name(label)) {
+          tick_clock::overhead();                // calibrate before first use
+        }
+        std::uint32_t id() const noexcept { return id_; }
+        std::uint32_t trace_id() const noexcept { return trace_; }
+      private:
+        const std::uint32_t id_, trace_;
+    };
+
+    class scope {
+      public:
+        explicit scope(const scope_site & site)
+          : tree_(scope_tree::instance().enter(site.id())),
+            traced_(trace_on().load(std::memory_order_relaxed)) {
+          if(traced_) trace_local().append('B', site.trace_id());
+        }
+        ~scope() {
+          scope_tree::leave(tree_);
+          if(traced_) trace_local().append('E', 0);
+        }
+        scope(const scope &) = delete;
+        scope & operator=(const scope &) = delete;
+      private:
+        void * const tree_;                      // scope_tree::thread_tree
+        const bool traced_;
+    };
+
+    // dout_FLOW: sets the flow ID of the thread for the scope
+    class flow_scope {
+      public:
+        explicit flow_scope(const std::uint64_t id)
+          : previous_(flow_local()), traced_(trace_on().load(std::memory_order_relaxed)) {
+          flow_local() = id;
+          if(traced_) {
+            trace_buffer & b = trace_local();
+            b.append('B', trace_flow_name());
+            b.append('f', trace_flow_name());
+          }
+        }
+        ~flow_scope() {
+          if(traced_) trace_local().append('E', 0);
+          flow_local() = previous_;
+        }
+        flow_scope(const flow_scope &) = delete;
+        flow_scope & operator=(const flow_scope &) = delete;
+      private:
+        const std::uint64_t previous_;
+        const bool traced_;
+    };
+
+    // DEBUGPRINTER_INSTRUMENT: __cyg_profile_func_enter/exit and the
+    // registration of the report
+    DEBUGPRINTER_NO_INSTRUMENT
+    static void instrument_enter(const void * fn) noexcept {
+      DebugPrinter::instrument_enter(fn);
+    }
+    DEBUGPRINTER_NO_INSTRUMENT
+    static void instrument_exit() noexcept {
+      DebugPrinter::instrument_exit();
+    }
+    static bool instrument_register(const DebugPrinter & d) {
+      return DebugPrinter::instrument_register(d);
+    }
+
+    // dout_HERE, dout_TRACE_INSTANT and dout_TRACE_COUNTER
+    class trace_site {
+      public:
+        explicit trace_site(const std::string & name) : id_(trace_name(name)) {}
+        void instant() const { trace('i', id_); }
+        void counter(const double value) const { trace('C', id_, value); }
+      private:
+        const std::uint32_t id_;
+    };
+
+    // dout_COUNT and dout_COUNT_N
+    class count_site {
+      public:
+        count_site(const DebugPrinter & d, const std::string & label,
+                   const char * file, const int line)
+          : id_(site_table<count_slot>::instance().add(d, label, file, line)) {}
+        void add(const std::uint64_t n) const {
+          bump(site_table<count_slot>::instance().local(id_).count, n);
+        }
+      private:
+        const std::size_t id_;
+    };
+
+    // dout_PERF: one perf_site per use site, one perf_scope per pass
+    class perf_site {
+      public:
+        perf_site(const DebugPrinter & d, const std::string & label,
+                  const char * file, const int line)
+          : id_(site_table<perf_slot>::instance().add(d, label, file, line)) {
+          tick_clock::overhead();                // calibrate before first use
+          perf_events();
+        }
+        void record(const std::uint64_t ticks, const std::uint64_t * start,
+                    const std::uint64_t * stop) const {
+          site_table<perf_slot>::instance().local(id_).record(ticks, start, stop);
+        }
+      private:
+        const std::size_t id_;
+    };
+
+    class perf_scope {
+      public:
+        explicit perf_scope(const perf_site & site)
+          : site_(site), read_(perf_group::local().read(start_)),
+            tick_(tick_clock::now()) {
+          static_assert(sizeof start_ == perf_max_events * sizeof *start_, "");
+        }
+        ~perf_scope() {
+          const std::uint64_t tick = tick_clock::now();
+          std::uint64_t stop[perf_max_events] = {};
+          const bool read = read_ && perf_group::local().read(stop);
+          site_.record(tick_clock::elapsed(tick_, tick), read ? start_ : nullptr, stop);
+        }
+        perf_scope(const perf_scope &) = delete;
+        perf_scope & operator=(const perf_scope &) = delete;
+      private:
+        const perf_site & site_;
+        std::uint64_t start_[4] = {};            // perf_max_events
+        const bool read_;
+        const std::uint64_t tick_;
+    };
+
+    // dout_RUSAGE: one rusage_site per use site, one rusage_scope per pass
+    class rusage_site {
+      public:
+        rusage_site(const DebugPrinter & d, const std::string & label,
+                    const char * file, const int line, const std::uint64_t every)
+          : id_(site_table<rusage_slot>::instance().add(d, label, file, line)),
+            every_(every == 0 ? 1 : every) {
+          tick_clock::overhead();                // calibrate before first use
+          rusage_rchar_overhead();
+        }
+        // Counts the pass, true if it is to be sampled
+        bool pass() const {
+          auto & count = site_table<rusage_slot>::instance().local(id_).count;
+          const std::uint64_t n = count.load(std::memory_order_relaxed);
+          bump(count, std::uint64_t(1));
+          return n % every_ == 0;
+        }
+        void record(const std::uint64_t ticks, const std::uint64_t * start,
+                    const std::uint64_t * stop) const {
+          rusage_slot & s = site_table<rusage_slot>::instance().local(id_);
+          bump(s.sampled, std::uint64_t(1));
+          bump(s.ticks, ticks);
+          for(std::size_t i = 0; i < rusage_fields; ++i)
+            if(i != ru_rchar)
+              bump(s.fields[i], stop[i] - start[i]);
+          const std::uint64_t rchar = stop[ru_rchar] - start[ru_rchar];
+          bump(s.fields[ru_rchar], rchar - std::min(rchar, rusage_rchar_overhead()));
+        }
+      private:
+        const std::size_t id_;
+        const std::uint64_t every_;
+    };
+
+    class rusage_scope {
+      public:
+        explicit rusage_scope(const rusage_site & site)
+          : site_(site), sampled_(site.pass()) {
+          static_assert(sizeof start_ == rusage_fields * sizeof *start_, "");
+          if(sampled_) {
+            rusage_read(start_);
+            tick_ = tick_clock::now();
+          }
+        }
+        ~rusage_scope() {
+          if(!sampled_) return;
+          const std::uint64_t tick = tick_clock::now();
+          std::uint64_t stop[rusage_fields];
+          rusage_read(stop);
+          site_.record(tick_clock::elapsed(tick_, tick), start_, stop);
+        }
+        rusage_scope(const rusage_scope &) = delete;
+        rusage_scope & operator=(const rusage_scope &) = delete;
+      private:
+        const rusage_site & site_;
+        const bool sampled_;
+        std::uint64_t start_[9] = {};            // rusage_fields
+        std::uint64_t tick_ = 0;
+    };
+
+    // dout_TRIP
+    class trip_site {
+      public:
+        trip_site(const DebugPrinter & d, const std::string & label,
+                  const char * file, const int line)
+          : id_(site_table<trip_slot>::instance().add(d, label, file, line)) {}
+        void record(const std::uint64_t n) const {
+          site_table<trip_slot>::instance().local(id_).record(n);
+        }
+      private:
+        const std::size_t id_;
+    };
+
+    // dout_BRANCH
+    class branch_site {
+      public:
+        branch_site(const DebugPrinter & d, const std::string & label,
+                    const char * file, const int line)
+          : id_(site_table<branch_slot>::instance().add(d, label, file, line)) {}
+        bool record(const bool c) const {
+          branch_slot & s = site_table<branch_slot>::instance().local(id_);
+          bump(c ? s.taken : s.not_taken, std::uint64_t(1));
+          return c;
+        }
+      private:
+        const std::size_t id_;
+    };
+
+    // dout_STAT and dout_STAT_LAST
+    class stat_site {
+      public:
+        stat_site(const DebugPrinter & d, const std::string & label,
+                  const char * file, const int line)
+          : id_(site_table<stat_slot>::instance().add(d, label, file, line)) {}
+        void record(const double value) const {
+          site_table<stat_slot>::instance().local(id_).record(value);
+        }
+        void record_last(const double value) const {
+          site_table<stat_slot>::instance().local(id_).record_last(value);
+        }
+      private:
+        const std::size_t id_;
+    };
+
+    // dout_HIST and dout_HIST_TIMER (Time: values are ticks)
+    template <bool Time>
+    class hist_site {
+      public:
+        hist_site(const DebugPrinter & d, const std::string & label,
+                  const char * file, const int line)
+          : id_(site_table<hist_slot<Time>>::instance().add(d, label, file, line)) {
+          tick_clock::overhead();                // calibrate before first use
+        }
+        void record(const double value) const {
+          site_table<hist_slot<Time>>::instance().local(id_).record(value);
+        }
+      private:
+        const std::size_t id_;
+    };
+
+    class hist_timer {
+      public:
+        explicit hist_timer(const hist_site<true> & site) noexcept
+          : site_(site), start_(tick_clock::now()) {}
+        ~hist_timer() {
+          const std::uint64_t stop = tick_clock::now();
+          site_.record(static_cast<double>(tick_clock::elapsed(start_, stop)));
+        }
+        hist_timer(const hist_timer &) = delete;
+        hist_timer & operator=(const hist_timer &) = delete;
+      private:
+        const hist_site<true> & site_;
+        const std::uint64_t start_;
+    };
+
+    // dout_NPY: empty path means <file stem>_<line>_<hit>.npy
+    template <typename R>
+    bool npy(const char * file, const int line, const unsigned hit,
+             const R & range, std::string path = "",
+             const std::initializer_list<std::size_t> shape = {}) const {
+      if(path.empty()) {
+        path = filemacro_name(file);
+        path = path.substr(0, path.rfind('.')) + "_" + std::to_string(line)
+             + "_" + std::to_string(hit) + ".npy";
+      }
+      return super.npy(path, range, shape);
+    }
+
+  } const detail_{*this};
+  /// \endcond
+
+/*******************************************************************************
+ * DebugPrinter private parts
+ */
+
+  private:
+
+  std::ostream * outstream;                      // output stream
+  std::shared_ptr<std::ostream> outstream_mm;    // managed output stream
+  std::streamsize prec_;                         // precision
+  std::size_t max_elem_;                         // container element budget
+  std::size_t max_bytes_;                        // hex dump byte budget
+  double peak_gbs_;                              // dout_THROUGHPUT peak
+  std::string hcol_;                             // highlighting color
+  std::string hcol_r_;                           // neutral color
+
+  static const unsigned int max_backtrace = 50;
+  static const unsigned int max_demangled = 4096;
+
+  #ifndef DEBUGPRINTER_NO_SIGNALS
+  using sig_type = int;
+  static std::map<sig_type, std::string> sig_names() {
+    std::map<sig_type, std::string> res;
+    res[SIGABRT] = "SIGABRT";
+    res[SIGFPE] = "SIGFPE";
+    res[SIGSEGV] = "SIGSEGV";
+    res[SIGSYS] = "SIGSYS";
+    return res;
+  }
+  //~ static DebugPrinter & static_init() { static DebugPrinter d; return d; }
+  static void signal_handler(int signum) {
+    static DebugPrinter d;
+    d << "DebugPrinter handler caught signal "
+      << sig_names()[signum] << " (" << signum << ")" << std::endl;
+    //~ static_init().stack(max_backtrace, false, 3);
+    d.stack(max_backtrace, false, 3);
+    struct sigaction act;
+    act.sa_handler = SIG_DFL;
+    sigaction(signum, &act, NULL);
   }
   #endif // DEBUGPRINTER_NO_SIGNALS
 
   #ifndef DEBUGPRINTER_NO_CXXABI
 
-  inline std::string demangle(const std::string & str, int & status) const {
+  static std::string demangle(const std::string & str, int & status) {
     std::unique_ptr<char, void(*)(void*)>  // needs to call free, not delete
       dmgl(abi::__cxa_demangle(str.c_str(), 0, 0, &status), std::free);
     return (status==0) ? dmgl.get() : str;  // calls string ctor for char*
@@ -535,7 +1924,7 @@ class DebugPrinter {
 
   #else // DEBUGPRINTER_NO_CXXABI
 
-  inline std::string demangle(const std::string & str, int &) const noexcept {
+  static std::string demangle(const std::string & str, int &) noexcept {
     return str;
   }
 
@@ -543,13 +1932,13 @@ class DebugPrinter {
 
   // Fetch different parts from a stack trace line
   #ifdef __APPLE__
-  inline std::string prog_part(const std::string str) const {
+  static std::string prog_part(const std::string str) {
     std::stringstream ss(str);
     std::string res;
     ss >> res; ss >> res;
     return res;
   }
-  inline std::string mangled_part(const std::string str) const {
+  static std::string mangled_part(const std::string str) {
     std::stringstream ss(str);
     std::string res;
     ss >> res; ss >> res; ss >> res; ss >> res;
@@ -568,10 +1957,10 @@ class DebugPrinter {
     return res;
   }
   #else
-  inline std::string prog_part(const std::string str) const {
+  static std::string prog_part(const std::string str) {
     return str.substr(0, str.find("("));
   }
-  inline std::string mangled_part(const std::string str) const {
+  static std::string mangled_part(const std::string str) {
     std::string::size_type pos = str.find("(") + 1;
     if(str.find("+", pos) == std::string::npos) return "";
     return str.substr(pos, str.find("+", pos) - pos);
@@ -594,22 +1983,34 @@ class DebugPrinter {
                             [](char c) { return !std::isdigit(c); }) == s.end();
   }
 
+  // Output stream at the start of a line: prints the flow() prefix
+  std::ostream & line_start() const {
+    std::ostream & out = *outstream;
+    if(const std::uint64_t id = flow_local())
+      out << "[flow " << id << "] ";
+    return out;
+  }
+
   // Implementation of operator()
   template <bool B, typename U, typename V>
   std::enable_if_t<!B>
   print_stream_impl(const U& label, const V& obj, const std::string&) const {
     auto typ = [this](const auto & obj)  // careless (dummy) demangle wrapper
                { int dummy = 0; return demangle(typeid(obj).name(), dummy); };
-    *outstream << "DebugPrinter error: object of type "
-               << ( has_stream<U> ? typ(obj) : typ(label) ) << std::endl
+    line_start() << "DebugPrinter error: object of type "
+               << ( is_printable<U>() ? typ(obj) : typ(label) ) << std::endl
                << "                    has no suitable " << typ(*outstream)
                << " operator<< overload." << std::endl;
   }
   template <bool B, typename U, typename V>
   std::enable_if_t<B>
   print_stream_impl(const U& label, const V& obj, const std::string& sc) const {
-    *outstream << hcol_ << label << sc << obj
-               << hcol_r_ << std::endl;
+    std::ostream & out = line_start();
+    out << hcol_;
+    format(out, label);
+    out << sc;
+    format(out, obj);
+    out << hcol_r_ << std::endl;
   }
 
 
@@ -628,21 +2029,3653 @@ class DebugPrinter {
   struct m_and : public m_and_impl<true, T...>::type {
   };
 
-  template<typename T, typename S>
-  struct has_stream_impl {
-    template <typename T_, typename S_>
-    static auto check(T_ && t, S_ && s) -> decltype(  // test for any expression:
-      s << t,
-    std::true_type());
-    static std::false_type check(...);
-    using type = decltype(check( std::declval<T>(), std::declval<S>()));
-  };
-  template<typename T, typename S = std::ostream&>
-  struct has_stream_t : public has_stream_impl<T, S>::type {};  // ::type stl boolean has ::value
-  template<typename T, typename S = std::ostream&>
-  static constexpr bool has_stream = has_stream_impl<T, S>::type::value;
+  template<typename T, typename S>
+  struct has_stream_impl {
+    template <typename T_, typename S_>
+    static auto check(T_ && t, S_ && s) -> decltype(  // test for any expression:
+      s << t,
+    std::true_type());
+    static std::false_type check(...);
+    using type = decltype(check( std::declval<T>(), std::declval<S>()));
+  };
+  template<typename T, typename S = std::ostream&>
+  struct has_stream_t : public has_stream_impl<T, S>::type {};  // ::type stl boolean has ::value
+  template<typename T, typename S = std::ostream&>
+  static constexpr bool has_stream = has_stream_impl<T, S>::type::value;
+
+  // Enums with an operator<< of their own (not the one of the integer an
+  // unscoped enum converts to): enum_exact converts to nothing but E
+  template <typename E>
+  struct enum_exact {
+    template <typename X, typename = std::enable_if_t<std::is_same<X, E>::value>>
+    operator X() const;
+  };
+  template <typename E, bool = std::is_enum<E>::value>
+  struct has_enum_stream_impl : std::false_type {};
+  template <typename E>
+  struct has_enum_stream_impl<E, true> {
+    template <typename E_>
+    static auto check(int) -> decltype(
+      operator<<(std::declval<std::ostream &>(), enum_exact<E_>()),
+    std::true_type());
+    template <typename E_>
+    static std::false_type check(...);
+    static constexpr bool value =
+      std::is_convertible<E, std::underlying_type_t<E>>::value
+      ? decltype(check<E>(0))::value : has_stream<const E &>;
+  };
+  template <typename E>
+  static constexpr bool has_enum_stream = has_enum_stream_impl<E>::value;
+
+  // Used for container printing (operator() and operator<< on DebugPrinter)
+  template<typename T>
+  struct is_range_impl {
+    template <typename T_>
+    static auto check(T_ && t) -> decltype(
+      std::begin(t) != std::end(t), *std::begin(t),
+    std::true_type());
+    static std::false_type check(...);
+    using type = decltype(check(std::declval<const T &>()));
+  };
+  template<typename T>
+  static constexpr bool is_range = is_range_impl<T>::type::value;
+
+  template<typename T>
+  struct is_tuple_impl {
+    template <typename T_>
+    static auto check(T_ *) -> decltype(std::tuple_size<T_>::value,
+                                        std::true_type());
+    static std::false_type check(...);
+    using type = decltype(check(static_cast<T *>(nullptr)));
+  };
+  template<typename T>
+  static constexpr bool is_tuple = is_tuple_impl<T>::type::value;
+
+  template<typename T>
+  struct has_size_impl {
+    template <typename T_>
+    static auto check(T_ && t) -> decltype(std::size_t(t.size()),
+                                           std::true_type());
+    static std::false_type check(...);
+    using type = decltype(check(std::declval<const T &>()));
+  };
+
+  template<typename T>
+  struct has_mapped_impl {
+    template <typename T_>
+    static auto check(T_ *) -> decltype(std::declval<typename T_::key_type>(),
+                                        std::declval<typename T_::mapped_type>(),
+                                        std::true_type());
+    static std::false_type check(...);
+    using type = decltype(check(static_cast<T *>(nullptr)));
+  };
+
+  template<typename T>
+  struct has_key_impl {
+    template <typename T_>
+    static auto check(T_ *) -> decltype(std::declval<typename T_::key_type>(),
+                                        std::true_type());
+    static std::false_type check(...);
+    using type = decltype(check(static_cast<T *>(nullptr)));
+  };
+
+  template <typename T>
+  using range_value_t = std::decay_t<decltype(*std::begin(std::declval<const T &>()))>;
+
+  template <typename T>
+  struct is_char_t : std::integral_constant<bool,
+                                            std::is_same<T, char>::value
+                                         || std::is_same<T, signed char>::value
+                                         || std::is_same<T, unsigned char>::value> {};
+
+  // Types without operator<< that we know how to print
+  template <typename T>
+  struct duration_traits : std::false_type {};
+  template <typename R, typename P>
+  struct duration_traits<std::chrono::duration<R, P>> : std::true_type {};
+
+  template <typename T>
+  struct smart_ptr_traits : std::false_type {};
+  template <typename T, typename D>
+  struct smart_ptr_traits<std::unique_ptr<T, D>> : std::true_type {
+    static const T * get(const std::unique_ptr<T, D> & p) { return p.get(); }
+  };
+  template <typename T, typename D>
+  struct smart_ptr_traits<std::unique_ptr<T[], D>> : std::true_type {
+    static const void * get(const std::unique_ptr<T[], D> & p) { return p.get(); }
+  };
+  template <typename T>
+  struct smart_ptr_traits<std::shared_ptr<T>> : std::true_type {
+    static const T * get(const std::shared_ptr<T> & p) { return p.get(); }
+  };
+  template <typename T>
+  struct smart_ptr_traits<std::weak_ptr<T>> : std::true_type {};
+
+  // (dummy V: no explicit specialisation in class scope)
+  template <typename T, typename V = void>
+  struct empty_traits : std::false_type {};
+  template <typename V>
+  struct empty_traits<std::nullptr_t, V> : std::true_type {
+    static const char * name() { return "nullptr"; }
+  };
+
+  template <typename T>
+  struct optional_traits : std::false_type {
+    static constexpr bool printable() { return false; }
+  };
+  template <typename T>
+  struct variant_traits : std::false_type {
+    static constexpr bool printable() { return false; }
+  };
+
+  #ifdef DEBUGPRINTER_CXX17
+  template <typename V>
+  struct empty_traits<std::nullopt_t, V> : std::true_type {
+    static const char * name() { return "nullopt"; }
+  };
+  template <typename V>
+  struct empty_traits<std::monostate, V> : std::true_type {
+    static const char * name() { return "monostate"; }
+  };
+  template <typename T>
+  struct optional_traits<std::optional<T>> : std::true_type {
+    static constexpr bool printable() { return is_printable<T>(); }
+  };
+  template <typename... T>
+  struct variant_traits<std::variant<T...>> : std::true_type {
+    static constexpr bool printable() {
+      return m_and<std::integral_constant<bool, is_printable<T>()>...>::value;
+    }
+  };
+  #endif // DEBUGPRINTER_CXX17
+
+  // Aggregate reflection: count fields by brace-initialising from any_field,
+  // then access them through structured bindings (printed as {a: 1, b: 2})
+  template <typename T, typename V = void>
+  struct aggregate_traits : std::false_type {
+    static constexpr bool printable() { return false; }
+  };
+
+  #ifdef DEBUGPRINTER_CXX17
+  static constexpr std::size_t max_fields = 16;
+
+  struct any_field {
+    template <typename T>
+    constexpr operator T() const noexcept;  // only used unevaluated
+  };
+  template <std::size_t>
+  using any_field_t = any_field;
+
+  template <typename T, std::size_t... I>
+  static constexpr auto brace_constructible(std::index_sequence<I...>, int)
+    -> decltype(T{any_field_t<I>()...}, bool()) { return true; }
+  template <typename T, typename S>
+  static constexpr bool brace_constructible(S, long) { return false; }
+
+  // Largest N with T{any_field x N} valid, max_fields + 1 if too large
+  template <typename T, std::size_t N = 0>
+  static constexpr std::size_t field_count() {
+    if constexpr(!brace_constructible<T>(std::make_index_sequence<N + 1>(), 0))
+      return N;
+    else if constexpr(N < max_fields)
+      return field_count<T, N + 1>();
+    else
+      return max_fields + 1;
+  }
+
+  // Brace elision lets one any_field initialise each element of a C-array
+  // member and a base class take one, while structured bindings need exactly
+  // the direct members: T{{} x N} only takes one {} per direct member
+  // (and base), and any_base only converts to a base of T
+  template <typename T, std::size_t N>
+  static constexpr bool direct_fields(std::integral_constant<std::size_t, N>,
+                                      long) { return false; }
+  #define DEBUGPRINTER_DIRECT_SPEC(n, ...)                                     \
+  template <typename T>                                                        \
+  static constexpr auto direct_fields(std::integral_constant<std::size_t, n>,  \
+                                      int) -> decltype(T{__VA_ARGS__}, bool()) {\
+    return true;                                                               \
+  }                                                                           //
+  DEBUGPRINTER_DIRECT_SPEC(1, {})
+  DEBUGPRINTER_DIRECT_SPEC(2, {}, {})
+  DEBUGPRINTER_DIRECT_SPEC(3, {}, {}, {})
+  DEBUGPRINTER_DIRECT_SPEC(4, {}, {}, {}, {})
+  DEBUGPRINTER_DIRECT_SPEC(5, {}, {}, {}, {}, {})
+  DEBUGPRINTER_DIRECT_SPEC(6, {}, {}, {}, {}, {}, {})
+  DEBUGPRINTER_DIRECT_SPEC(7, {}, {}, {}, {}, {}, {}, {})
+  DEBUGPRINTER_DIRECT_SPEC(8, {}, {}, {}, {}, {}, {}, {}, {})
+  DEBUGPRINTER_DIRECT_SPEC(9, {}, {}, {}, {}, {}, {}, {}, {}, {})
+  DEBUGPRINTER_DIRECT_SPEC(10, {}, {}, {}, {}, {}, {}, {}, {}, {}, {})
+  DEBUGPRINTER_DIRECT_SPEC(11, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {})
+  DEBUGPRINTER_DIRECT_SPEC(12, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {})
+  DEBUGPRINTER_DIRECT_SPEC(13, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {},
+                               {})
+  DEBUGPRINTER_DIRECT_SPEC(14, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {},
+                               {}, {})
+  DEBUGPRINTER_DIRECT_SPEC(15, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {},
+                               {}, {}, {})
+  DEBUGPRINTER_DIRECT_SPEC(16, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {},
+                               {}, {}, {}, {})
+  #undef DEBUGPRINTER_DIRECT_SPEC
+
+  template <typename T>
+  struct any_base {
+    template <typename U, typename = std::enable_if_t<
+      std::is_base_of<U, T>::value && !std::is_same<U, T>::value>>
+    constexpr operator U() const noexcept;  // only used unevaluated
+  };
+  template <typename T>
+  static constexpr auto has_base(int) -> decltype(T{any_base<T>()}, bool()) {
+    return true;
+  }
+  template <typename T>
+  static constexpr bool has_base(long) { return false; }
+
+  template <typename T>
+  static constexpr auto tie_fields(const T &,
+                                   std::integral_constant<std::size_t, 0>) {
+    return std::tuple<>();
+  }
+  #define DEBUGPRINTER_FIELDS_SPEC(n, ...)                                     \
+  template <typename T>                                                        \
+  static constexpr auto tie_fields(const T & obj,                              \
+                                   std::integral_constant<std::size_t, n>) {   \
+    const auto & [__VA_ARGS__] = obj;                                          \
+    return std::tie(__VA_ARGS__);                                              \
+  }                                                                           //
+  DEBUGPRINTER_FIELDS_SPEC(1, f0)
+  DEBUGPRINTER_FIELDS_SPEC(2, f0, f1)
+  DEBUGPRINTER_FIELDS_SPEC(3, f0, f1, f2)
+  DEBUGPRINTER_FIELDS_SPEC(4, f0, f1, f2, f3)
+  DEBUGPRINTER_FIELDS_SPEC(5, f0, f1, f2, f3, f4)
+  DEBUGPRINTER_FIELDS_SPEC(6, f0, f1, f2, f3, f4, f5)
+  DEBUGPRINTER_FIELDS_SPEC(7, f0, f1, f2, f3, f4, f5, f6)
+  DEBUGPRINTER_FIELDS_SPEC(8, f0, f1, f2, f3, f4, f5, f6, f7)
+  DEBUGPRINTER_FIELDS_SPEC(9, f0, f1, f2, f3, f4, f5, f6, f7, f8)
+  DEBUGPRINTER_FIELDS_SPEC(10, f0, f1, f2, f3, f4, f5, f6, f7, f8, f9)
+  DEBUGPRINTER_FIELDS_SPEC(11, f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10)
+  DEBUGPRINTER_FIELDS_SPEC(12, f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11)
+  DEBUGPRINTER_FIELDS_SPEC(13, f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11,
+                               f12)
+  DEBUGPRINTER_FIELDS_SPEC(14, f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11,
+                               f12, f13)
+  DEBUGPRINTER_FIELDS_SPEC(15, f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11,
+                               f12, f13, f14)
+  DEBUGPRINTER_FIELDS_SPEC(16, f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11,
+                               f12, f13, f14, f15)
+  #undef DEBUGPRINTER_FIELDS_SPEC
+
+  template <typename T>
+  using fields_t = decltype(tie_fields(std::declval<const T &>(),
+                     std::integral_constant<std::size_t, field_count<T>()>()));
+
+  template <typename T, std::size_t... I>
+  static constexpr bool fields_printable(std::index_sequence<I...>) {
+    return m_and<std::integral_constant<bool, is_printable<
+             std::decay_t<std::tuple_element_t<I, fields_t<T>>>>()>...>::value;
+  }
+
+  template <typename T>
+  struct aggregate_traits<T, std::enable_if_t<std::is_aggregate<T>::value
+                                           && !std::is_union<T>::value
+                                           && !std::is_array<T>::value>>
+    : std::true_type {
+    static constexpr std::size_t size() { return field_count<T>(); }
+    static constexpr bool printable() {
+      if constexpr(size() > max_fields)
+        return false;
+      else if constexpr(size() == 0)        // fields not constructible
+        return std::is_empty<T>::value;
+      else if constexpr(has_base<T>(0)      // no structured binding of size()
+                        || !direct_fields<T>(
+                             std::integral_constant<std::size_t, size()>(), 0))
+        return false;
+      else
+        return fields_printable<T>(std::make_index_sequence<size()>());
+    }
+  };
+
+  #ifdef DEBUGPRINTER_CXX20
+  // Field names from the __PRETTY_FUNCTION__ of a pointer to a member of an
+  // (undefined) object, e.g. "[with auto P = field_ptr<int>{(& fake<S>.S::a)}; "
+  // for GCC and "[P = field_ptr<int>{&fake.a}]" for Clang
+  template <typename T>
+  struct field_ptr { const T * p; };
+
+  template <typename T>
+  static const T fake_object;
+
+  template <auto P>
+  static constexpr std::string_view field_signature() {
+    return __PRETTY_FUNCTION__;
+  }
+
+  static constexpr bool is_ident_char(const char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+        || (c >= '0' && c <= '9') || c == '_';
+  }
+
+  template <typename T, std::size_t I>
+  static constexpr auto field_address() {
+    using F = std::remove_reference_t<std::tuple_element_t<I, fields_t<T>>>;
+    return field_ptr<F>{&std::get<I>(tie_fields(fake_object<T>,
+                         std::integral_constant<std::size_t, field_count<T>()>()))};
+  }
+
+  static constexpr std::string_view field_name_parse(const std::string_view sig) {
+    std::size_t end = sig.find("; ", sig.find("P = "));   // GCC
+    if(end == std::string_view::npos) end = sig.rfind(']');  // Clang
+    while(end > 0 && !is_ident_char(sig[end - 1])) --end;
+    std::size_t begin = end;
+    while(begin > 0 && is_ident_char(sig[begin - 1])) --begin;
+    return sig.substr(begin, end - begin);
+  }
+
+  // (variable template: forces compile-time evaluation, fake_object stays unused)
+  template <typename T, std::size_t I>
+  static constexpr std::string_view field_name =
+    field_name_parse(field_signature<field_address<T, I>()>());
+  #else // DEBUGPRINTER_CXX20
+  template <typename T, std::size_t I>
+  static constexpr std::string_view field_name = "";
+  #endif // DEBUGPRINTER_CXX20
+
+  #endif // DEBUGPRINTER_CXX17
+
+  // Enum names, parsed at compile time from the __PRETTY_FUNCTION__ of
+  // enum_value_name<E, V>() for every V in DebugPrinterEnumRange<E>, e.g.
+  // "[with E = State; E V = State::Running]" (GCC) or "[E = State, V = ...]"
+  // (Clang). Values without a name show up as "(State)5".
+  struct enum_name {
+    const char * str;
+    std::size_t size;
+  };
+
+  static constexpr std::size_t str_find(const char * s, const char * what,
+                                        const bool last = false) {
+    std::size_t res = 0;
+    for(std::size_t i = 0; s[i] != '\0'; ++i) {
+      std::size_t j = 0;
+      while(what[j] != '\0' && s[i + j] == what[j]) ++j;
+      if(what[j] == '\0') {
+        res = i + j;
+        if(!last) break;
+      }
+    }
+    return res;
+  }
+
+  static constexpr std::size_t str_until(const char * s, std::size_t pos) {
+    while(s[pos] != '\0' && s[pos] != ';' && s[pos] != ']') ++pos;
+    return pos;
+  }
+
+  template <typename E>
+  static constexpr enum_name enum_type_name() {
+    const char * s = __PRETTY_FUNCTION__;
+    const std::size_t begin = str_find(s, "E = ");
+    return {s + begin, str_until(s, begin) - begin};
+  }
+
+  template <typename E, E V>
+  static constexpr enum_name enum_value_name() {
+    const char * s = __PRETTY_FUNCTION__;
+    const std::size_t end = str_until(s, str_find(s, "V = ", true));
+    std::size_t begin = end;
+    while(begin > 0 && s[begin - 1] != ' ' && s[begin - 1] != ':'
+                    && s[begin - 1] != ')')
+      --begin;
+    if(s[begin - 1] == ')' || begin == end)   // "(E)5": not a named value
+      return {nullptr, 0};
+    return {s + begin, end - begin};
+  }
+
+  template <typename E>
+  using enum_int_t = std::conditional_t<
+    std::is_signed<std::underlying_type_t<E>>::value, long long,
+    unsigned long long>;
+
+  // Configured range, clamped to the underlying type
+  template <typename E>
+  static constexpr long long enum_min() {
+    using U = std::underlying_type_t<E>;
+    return std::max<long long>(DebugPrinterEnumRange<E>::min,
+                               std::numeric_limits<U>::min());
+  }
+  template <typename E>
+  static constexpr long long enum_max() {
+    using U = std::underlying_type_t<E>;
+    return std::min<long long>(DebugPrinterEnumRange<E>::max,
+      static_cast<long long>(std::min<unsigned long long>(
+        static_cast<unsigned long long>(std::numeric_limits<U>::max()),
+        static_cast<unsigned long long>(std::numeric_limits<long long>::max()))));
+  }
+
+  template <typename E, typename S>
+  struct enum_table;
+  template <typename E, long long... I>
+  struct enum_table<E, std::integer_sequence<long long, I...>> {
+    static constexpr enum_name names[] = {
+      enum_value_name<E, static_cast<E>(enum_min<E>() + I)>()...
+    };
+  };
+
+  template <typename E>
+  using enum_table_t = enum_table<E,
+    std::make_integer_sequence<long long, enum_max<E>() - enum_min<E>() + 1>>;
+
+  // Formatting categories, the first matching one in fmt_kind_of() is used
+  enum class fmt_kind { none, stream, range, tuple, pointer, duration, empty,
+                        optional, variant, aggregate, enumeration };
+
+  template <fmt_kind K>
+  using fmt_tag = std::integral_constant<fmt_kind, K>;
+
+  template <typename T>
+  static constexpr fmt_kind fmt_kind_of() {
+    using U = std::remove_cv_t<T>;
+    if(std::is_enum<U>::value && !has_enum_stream<U>)
+      return fmt_kind::enumeration;
+    if(duration_traits<U>::value) return fmt_kind::duration;
+    if(smart_ptr_traits<U>::value) return fmt_kind::pointer;
+    if(empty_traits<U>::value)    return fmt_kind::empty;
+    if(optional_traits<U>::value)
+      return optional_traits<U>::printable() ? fmt_kind::optional : fmt_kind::none;
+    if(variant_traits<U>::value)
+      return variant_traits<U>::printable() ? fmt_kind::variant : fmt_kind::none;
+    if(std::is_array<U>::value                                // no pointer decay
+       && !is_char_t<std::remove_cv_t<std::remove_extent_t<U>>>::value)
+      return range_printable<U>() ? fmt_kind::range : fmt_kind::none;
+    if(has_stream<const U &>)     return fmt_kind::stream;
+    if(range_printable<U>())      return fmt_kind::range;
+    if(tuple_printable<U>())      return fmt_kind::tuple;
+    if(aggregate_traits<U>::value)
+      return aggregate_traits<U>::printable() ? fmt_kind::aggregate : fmt_kind::none;
+    return fmt_kind::none;
+  }
+
+  template <typename T>
+  static constexpr bool is_printable() {
+    return fmt_kind_of<T>() != fmt_kind::none;
+  }
+
+  template <typename T>
+  static constexpr auto range_printable() -> std::enable_if_t<is_range<T>, bool> {
+    return is_printable<range_value_t<T>>();
+  }
+  template <typename T>
+  static constexpr auto range_printable() -> std::enable_if_t<!is_range<T>, bool> {
+    return false;
+  }
+
+  template <typename T, std::size_t... I>
+  static constexpr bool tuple_printable_impl(std::index_sequence<I...>) {
+    return m_and<std::integral_constant<bool,
+                   is_printable<std::tuple_element_t<I, T>>()>...>::value;
+  }
+  template <typename T>
+  static constexpr auto tuple_printable() -> std::enable_if_t<is_tuple<T>, bool> {
+    return tuple_printable_impl<T>(
+      std::make_index_sequence<std::tuple_size<T>::value>());
+  }
+  template <typename T>
+  static constexpr auto tuple_printable() -> std::enable_if_t<!is_tuple<T>, bool> {
+    return false;
+  }
+
+  // Print any printable object, recursing into elements
+  template <typename T>
+  void format(std::ostream & os, const T & obj) const {
+    format_impl(os, obj, fmt_tag<fmt_kind_of<T>()>());
+  }
+
+  // format() into a string, "?" if not printable
+  template <typename T>
+  std::string text(const T & obj) const {
+    std::stringstream ss;
+    text_impl(ss, obj, std::integral_constant<bool, is_printable<T>()>());
+    return ss.str();
+  }
+  template <typename T>
+  void text_impl(std::ostream & os, const T & obj, std::true_type) const {
+    format(os, obj);
+  }
+  template <typename T>
+  void text_impl(std::ostream & os, const T &, std::false_type) const {
+    os << "?";
+  }
+
+  template <typename T>
+  void format_impl(std::ostream & os, const T & obj,
+                   fmt_tag<fmt_kind::stream>) const {
+    os << obj;
+  }
+
+  template <typename T>
+  void format_impl(std::ostream & os, const T & obj,
+                   fmt_tag<fmt_kind::range>) const {
+    const bool keyed = has_key_impl<T>::type::value;   // maps and sets
+    format_range(os, obj, keyed ? "{" : "[", keyed ? "}" : "]",
+                 typename has_mapped_impl<T>::type());
+  }
+
+  template <typename T>
+  void format_impl(std::ostream & os, const T & obj,
+                   fmt_tag<fmt_kind::tuple>) const {
+    os << "(";
+    format_tuple(os, obj, std::make_index_sequence<std::tuple_size<T>::value>());
+    os << ")";
+  }
+
+  template <typename T>
+  void format_impl(std::ostream & os, const T & obj,
+                   fmt_tag<fmt_kind::pointer>) const {
+    format_pointee(os, smart_ptr_traits<T>::get(obj));
+  }
+  template <typename T>
+  void format_impl(std::ostream & os, const std::weak_ptr<T> & obj,
+                   fmt_tag<fmt_kind::pointer>) const {
+    if(auto p = obj.lock()) format_pointee(os, p.get());
+    else os << "expired";
+  }
+
+  template <typename R, typename P>
+  void format_impl(std::ostream & os, const std::chrono::duration<R, P> & obj,
+                   fmt_tag<fmt_kind::duration>) const {
+    format(os, obj.count());
+    if(std::is_same<P, std::nano>::value)              os << "ns";
+    else if(std::is_same<P, std::micro>::value)        os << "us";
+    else if(std::is_same<P, std::milli>::value)        os << "ms";
+    else if(std::is_same<P, std::ratio<1>>::value)     os << "s";
+    else if(std::is_same<P, std::ratio<60>>::value)    os << "min";
+    else if(std::is_same<P, std::ratio<3600>>::value)  os << "h";
+    else os << "[" << P::num << "/" << P::den << "]s";
+  }
+
+  template <typename T>
+  void format_impl(std::ostream & os, const T & obj,
+                   fmt_tag<fmt_kind::enumeration>) const {
+    constexpr enum_name type = enum_type_name<T>();
+    const auto value = static_cast<enum_int_t<T>>(obj);
+    const auto index = static_cast<long long>(value);  // huge unsigned -> < 0
+    const enum_name name = (index >= enum_min<T>() && index <= enum_max<T>())
+                         ? enum_table_t<T>::names[index - enum_min<T>()]
+                         : enum_name{nullptr, 0};
+    if(name.str != nullptr) {
+      os.write(type.str, static_cast<std::streamsize>(type.size));
+      os << "::";
+      os.write(name.str, static_cast<std::streamsize>(name.size));
+      os << " (" << value << ")";
+    } else {
+      os << "(";
+      os.write(type.str, static_cast<std::streamsize>(type.size));
+      os << ")" << value;
+    }
+  }
+
+  template <typename T>
+  void format_impl(std::ostream & os, const T &,
+                   fmt_tag<fmt_kind::empty>) const {
+    os << empty_traits<T>::name();
+  }
+
+  #ifdef DEBUGPRINTER_CXX17
+  template <typename T>
+  void format_impl(std::ostream & os, const std::optional<T> & obj,
+                   fmt_tag<fmt_kind::optional>) const {
+    if(obj) format(os, *obj);
+    else os << "nullopt";
+  }
+
+  template <typename... T>
+  void format_impl(std::ostream & os, const std::variant<T...> & obj,
+                   fmt_tag<fmt_kind::variant>) const {
+    if(obj.valueless_by_exception()) os << "valueless";
+    else std::visit([this, &os](const auto & v) { this->format(os, v); }, obj);
+  }
+
+  template <typename T>
+  void format_impl(std::ostream & os, const T & obj,
+                   fmt_tag<fmt_kind::aggregate>) const {
+    constexpr std::size_t n = aggregate_traits<T>::size();
+    os << "{";
+    format_fields<T>(os, tie_fields(obj, std::integral_constant<std::size_t, n>()),
+                     std::make_index_sequence<n>());
+    os << "}";
+  }
+
+  template <typename T, typename F, std::size_t... I>
+  void format_fields(std::ostream & os, const F & fields,
+                     std::index_sequence<I...>) const {
+    (..., (os << (I == 0 ? "" : ", ") << field_name<T, I>
+              << (field_name<T, I>.empty() ? "" : ": "),
+           format(os, std::get<I>(fields))));
+  }
+  #endif // DEBUGPRINTER_CXX17
+
+  template <typename T, std::size_t... I>
+  void format_tuple(std::ostream & os, const T & obj,
+                    std::index_sequence<I...>) const {
+    using std::get;
+    int dummy[] = {0, (os << (I == 0 ? "" : ", "), format(os, get<I>(obj)), 0)...};
+    (void)dummy;
+  }
+
+  template <typename T>
+  void format_entry(std::ostream & os, const T & obj, std::false_type) const {
+    format(os, obj);
+  }
+  template <typename T>
+  void format_entry(std::ostream & os, const T & obj, std::true_type) const {
+    format(os, obj.first);
+    os << ": ";
+    format(os, obj.second);
+  }
+
+  template <typename T>
+  std::size_t range_size(const T & obj, std::true_type) const {
+    return static_cast<std::size_t>(obj.size());
+  }
+  template <typename T>
+  std::size_t range_size(const T & obj, std::false_type) const {
+    return static_cast<std::size_t>(std::distance(std::begin(obj), std::end(obj)));
+  }
+
+  // Move to the first of the last n elements (it has skip elements before)
+  template <typename It>
+  It range_tail(It, It end, std::size_t, std::size_t n,
+                std::bidirectional_iterator_tag) const {
+    return std::prev(end, static_cast<std::ptrdiff_t>(n));
+  }
+  template <typename It>
+  It range_tail(It it, It, std::size_t skip, std::size_t,
+                std::forward_iterator_tag) const {
+    return std::next(it, static_cast<std::ptrdiff_t>(skip));
+  }
+
+  // Print head and tail of a range, eliding the middle part if over budget
+  template <typename T, typename M>
+  void format_range(std::ostream & os, const T & obj,
+                    const char * open, const char * close, M mapped) const {
+    auto it = std::begin(obj);
+    auto end = std::end(obj);
+    using It = decltype(it);
+    const std::size_t n = range_size(obj, typename has_size_impl<T>::type());
+    std::size_t head = n, tail = 0;
+    if(max_elem_ != 0 && n > max_elem_) {
+      head = (max_elem_ + 1) / 2;
+      tail = max_elem_ / 2;
+    }
+    os << open;
+    for(std::size_t i = 0; i < head; ++i, ++it) {
+      if(i != 0) os << ", ";
+      format_entry(os, *it, mapped);
+    }
+    if(head != n) {
+      os << ", ... (" << n - head - tail << " more)";
+      it = range_tail(it, end, n - head - tail, tail,
+                      typename std::iterator_traits<It>::iterator_category());
+      for(; it != end; ++it) {
+        os << ", ";
+        format_entry(os, *it, mapped);
+      }
+    }
+    os << close;
+  }
+
+  template <typename T>
+  void format_pointee(std::ostream & os, const T * p) const {
+    if(p == nullptr)
+      os << "nullptr";
+    else {
+      os << static_cast<const void *>(p);
+      format_deref(os, p, std::integral_constant<bool, is_printable<T>()>());
+    }
+  }
+  void format_pointee(std::ostream & os, const void * p) const {
+    if(p == nullptr) os << "nullptr";
+    else os << p;
+  }
+  template <typename T>
+  void format_deref(std::ostream & os, const T * p, std::true_type) const {
+    os << " -> ";
+    format(os, *p);
+  }
+  template <typename T>
+  void format_deref(std::ostream &, const T *, std::false_type) const {}
+
+
+  // Numeric kernels (dout_SUMMARY, dout_HEX). Vectorised with GCC vector extensions,
+  // compiled for several instruction sets and selected at runtime.
+  enum class simd_level { scalar, sse2, ssse3, avx2, avx512 };
+
+  static simd_level simd() noexcept {
+    #ifdef DEBUGPRINTER_SIMD_X86
+    static const simd_level level =
+        __builtin_cpu_supports("avx512f") ? simd_level::avx512
+      : __builtin_cpu_supports("avx2")    ? simd_level::avx2
+      : __builtin_cpu_supports("ssse3")   ? simd_level::ssse3
+      : __builtin_cpu_supports("sse2")    ? simd_level::sse2
+      :                                     simd_level::scalar;
+    return level;
+    #else
+    return simd_level::scalar;
+    #endif // DEBUGPRINTER_SIMD_X86
+  }
+
+  #ifdef DEBUGPRINTER_SIMD_X86
+  template <typename T, std::size_t B>       // B bytes of T
+  struct simd_vec {
+    typedef T type __attribute__((vector_size(B)));
+  };
+  #endif // DEBUGPRINTER_SIMD_X86
+
+  // Lane type used by the vectorised summary (void: scalar only)
+  template <typename T>
+  using simd_compute_t = std::conditional_t<
+      std::is_same<T, float>::value || std::is_same<T, double>::value, T,
+    std::conditional_t<std::is_integral<T>::value && !std::is_same<T, bool>::value
+                       && sizeof(T) <= 4, double, void>>;
+
+  // Running totals of dout_SUMMARY, min/max over finite values only
+  template <typename T>
+  struct summary_acc {
+    std::size_t count = 0, finite = 0, nan = 0, inf = 0, zero = 0;
+    std::size_t argmin = 0, argmax = 0;
+    T min = T(), max = T();
+    double shift = 0, sum = 0, sum2 = 0;     // sums of (x - shift)
+
+    void add(const T x, const std::size_t i) noexcept {
+      ++count;
+      if(x != x) { ++nan; return; }
+      if(x - x != 0) { ++inf; return; }       // only true for +-inf
+      if(finite == 0) {
+        shift = static_cast<double>(x);
+        min = max = x;
+        argmin = argmax = i;
+      } else {
+        if(x < min) { min = x; argmin = i; }
+        if(max < x) { max = x; argmax = i; }
+      }
+      ++finite;
+      if(x == 0) ++zero;
+      const double d = static_cast<double>(x) - shift;
+      sum += d;
+      sum2 += d * d;
+    }
+
+    // Fold in a finite block minimum/maximum (keeps the first index on ties)
+    void add_minmax(const T lo, const std::size_t ilo,
+                    const T hi, const std::size_t ihi) noexcept {
+      if(lo < min || (lo == min && ilo < argmin)) { min = lo; argmin = ilo; }
+      if(max < hi || (hi == max && ihi < argmax)) { max = hi; argmax = ihi; }
+    }
+  };
+
+  #ifdef DEBUGPRINTER_SIMD_X86
+  // One pass over p[0, n) in vectors of B bytes of C, converted from T.
+  // Work is done in blocks so that lane indices stay exact and each lane
+  // sums at most block / W terms before they are added up in double, which
+  // bounds the rounding error of float sums (it does not remove it).
+  template <typename T, typename C, std::size_t B>
+  __attribute__((always_inline)) static inline
+  void summary_simd(const T * p, const std::size_t n, summary_acc<C> & acc) {
+    using V = typename simd_vec<C, B>::type;
+    using M = decltype(V() < V());           // lane mask and index type
+    constexpr std::size_t W = B / sizeof(C);
+    using L = typename simd_vec<T, W * sizeof(T)>::type;
+    constexpr std::size_t block = 4096;
+
+    std::size_t i = 0;
+    while(i < n && acc.finite == 0)          // find the shift value
+      acc.add(static_cast<C>(p[i]), i), ++i;
+
+    using I = std::remove_reference_t<decltype(M()[0])>;
+    M iota;
+    for(std::size_t l = 0; l < W; ++l) iota[l] = static_cast<I>(l);
+    const V vshift = V() + static_cast<C>(acc.shift);
+    const C inf = std::numeric_limits<C>::infinity();
+
+    while(n - i >= W) {
+      const std::size_t len = std::min(block, (n - i) / W * W);
+      V vmin = V() + inf, vmax = V() - inf, s = V(), s2 = V();
+      M imin = M(), imax = M(), cfin = M(), cnan = M(), czero = M();
+      M idx = iota;
+      for(std::size_t j = 0; j < len; j += W, idx += static_cast<I>(W)) {
+        L raw;
+        std::memcpy(&raw, p + i + j, sizeof raw);
+        const V x = __builtin_convertvector(raw, V);
+        const M fin = (x - x) == V();        // false for NaN and +-inf
+        const M lt = (x < vmin) & fin;
+        const M gt = (x > vmax) & fin;
+        vmin = lt ? x : vmin;
+        imin = lt ? idx : imin;
+        vmax = gt ? x : vmax;
+        imax = gt ? idx : imax;
+        const V d = fin ? x - vshift : V();
+        s += d;
+        s2 += d * d;
+        cfin -= fin;
+        cnan -= (x != x);
+        czero -= (x == V());
+      }
+      std::size_t nfin = 0, nnan = 0;
+      for(std::size_t l = 0; l < W; ++l) {
+        nfin += static_cast<std::size_t>(cfin[l]);
+        nnan += static_cast<std::size_t>(cnan[l]);
+        acc.zero += static_cast<std::size_t>(czero[l]);
+        acc.sum += static_cast<double>(s[l]);
+        acc.sum2 += static_cast<double>(s2[l]);
+        if(vmin[l] != inf)
+          acc.add_minmax(vmin[l], i + static_cast<std::size_t>(imin[l]),
+                         vmax[l], i + static_cast<std::size_t>(imax[l]));
+      }
+      acc.count += len;
+      acc.finite += nfin;
+      acc.nan += nnan;
+      acc.inf += len - nfin - nnan;
+      i += len;
+    }
+    for(; i < n; ++i)
+      acc.add(static_cast<C>(p[i]), i);
+  }
+
+  template <typename T, typename C>
+  __attribute__((target("avx512f")))
+  static void summary_avx512(const T * p, std::size_t n, summary_acc<C> & acc) {
+    summary_simd<T, C, 64>(p, n, acc);
+  }
+  template <typename T, typename C>
+  __attribute__((target("avx2")))
+  static void summary_avx2(const T * p, std::size_t n, summary_acc<C> & acc) {
+    summary_simd<T, C, 32>(p, n, acc);
+  }
+  template <typename T, typename C>
+  static void summary_sse2(const T * p, std::size_t n, summary_acc<C> & acc) {
+    summary_simd<T, C, 16>(p, n, acc);
+  }
+  #endif // DEBUGPRINTER_SIMD_X86
+
+  template <typename T, typename It>
+  static void summary_scalar(It it, const std::size_t n, summary_acc<T> & acc) {
+    for(std::size_t i = 0; i < n; ++i, ++it)
+      acc.add(static_cast<T>(*it), i);
+  }
+
+  // Contiguous data: vectorised if the element type allows it
+  template <typename T>
+  static auto summarize(const T * p, const std::size_t n)
+    -> std::enable_if_t<!std::is_void<simd_compute_t<T>>::value,
+                        summary_acc<simd_compute_t<T>>> {
+    summary_acc<simd_compute_t<T>> acc;
+    switch(simd()) {
+      #ifdef DEBUGPRINTER_SIMD_X86
+      case simd_level::avx512: summary_avx512(p, n, acc); break;
+      case simd_level::avx2:   summary_avx2(p, n, acc);   break;
+      case simd_level::ssse3:
+      case simd_level::sse2:   summary_sse2(p, n, acc);   break;
+      #endif // DEBUGPRINTER_SIMD_X86
+      default:                 summary_scalar(p, n, acc);
+    }
+    return acc;
+  }
+  template <typename T>
+  static auto summarize(const T * p, const std::size_t n)
+    -> std::enable_if_t<std::is_void<simd_compute_t<T>>::value, summary_acc<T>> {
+    summary_acc<T> acc;
+    summary_scalar(p, n, acc);
+    return acc;
+  }
+
+  template<typename T>
+  struct is_contiguous_impl {
+    template <typename T_>
+    static auto check(T_ && t) -> decltype(
+      static_cast<const void *>(t.data()), std::size_t(t.size()),
+    std::true_type());
+    static std::false_type check(...);
+    using type = decltype(check(std::declval<const T &>()));
+  };
+
+  template <typename R>
+  static auto summarize(const R & r, std::true_type) {
+    return summarize(r.data(), static_cast<std::size_t>(r.size()));
+  }
+  template <typename R>
+  static auto summarize(const R & r, std::false_type) {
+    summary_acc<range_value_t<R>> acc;
+    summary_scalar(std::begin(r), static_cast<std::size_t>(
+                     std::distance(std::begin(r), std::end(r))), acc);
+    return acc;
+  }
+  template <typename T, std::size_t N>
+  static auto summarize(const T (&r)[N], std::false_type) {
+    return summarize(static_cast<const T *>(r), N);
+  }
+  template <typename T>
+  static auto summarize(const StridedView<T> & r, std::true_type) {
+    if(r.stride() == 1)
+      return summarize(r.data(), r.size());
+    summary_acc<decltype(summarize(r.data(), 0).min)> acc;
+    summary_scalar(r.begin(), r.size(), acc);
+    return acc;
+  }
+
+  // Non-finite values found by dout_CHECK_FINITE
+  struct finite_acc {
+    std::size_t count = 0, bad = 0, first = 0;
+    double value = 0;                        // value at first
+    template <typename T>
+    void add(const T x, const std::size_t i) noexcept {
+      if(!std::isfinite(x) && bad++ == 0) {
+        first = i;
+        value = static_cast<double>(x);
+      }
+    }
+  };
+
+  template <typename It>
+  static void finite_scalar(It it, const std::size_t n, const std::size_t i0,
+                            finite_acc & acc) {
+    for(std::size_t i = 0; i < n; ++i, ++it)
+      acc.add(*it, i0 + i);
+  }
+
+  #ifdef DEBUGPRINTER_SIMD_X86
+  // Counts non-finite lanes per block, blocks with offenders are rescanned
+  // scalar until the first one is known
+  template <typename T, std::size_t B>
+  __attribute__((always_inline)) static inline
+  void finite_simd(const T * p, const std::size_t n, finite_acc & acc) {
+    using V = typename simd_vec<T, B>::type;
+    using M = decltype(V() < V());
+    constexpr std::size_t W = B / sizeof(T);
+    constexpr std::size_t block = 4096;
+
+    std::size_t i = 0;
+    while(n - i >= W) {
+      const std::size_t len = std::min(block, (n - i) / W * W);
+      M cbad = M();
+      for(std::size_t j = 0; j < len; j += W) {
+        V x;
+        std::memcpy(&x, p + i + j, sizeof x);
+        cbad -= ((x - x) != V());            // NaN for NaN and +-inf
+      }
+      std::size_t nbad = 0;
+      for(std::size_t l = 0; l < W; ++l)
+        nbad += static_cast<std::size_t>(cbad[l]);
+      if(nbad != 0 && acc.bad == 0)
+        finite_scalar(p + i, len, i, acc);
+      else
+        acc.bad += nbad;
+      i += len;
+    }
+    finite_scalar(p + i, n - i, i, acc);
+  }
+
+  template <typename T>
+  __attribute__((target("avx512f")))
+  static void finite_avx512(const T * p, std::size_t n, finite_acc & acc) {
+    finite_simd<T, 64>(p, n, acc);
+  }
+  template <typename T>
+  __attribute__((target("avx2")))
+  static void finite_avx2(const T * p, std::size_t n, finite_acc & acc) {
+    finite_simd<T, 32>(p, n, acc);
+  }
+  template <typename T>
+  static void finite_sse2(const T * p, std::size_t n, finite_acc & acc) {
+    finite_simd<T, 16>(p, n, acc);
+  }
+  #endif // DEBUGPRINTER_SIMD_X86
+
+  template <typename T>
+  static void scan_finite(const T * p, const std::size_t n, finite_acc & acc) {
+    acc.count = n;
+    #ifdef DEBUGPRINTER_SIMD_X86
+    if(std::is_same<T, float>::value || std::is_same<T, double>::value) {
+      switch(simd()) {
+        case simd_level::avx512: finite_avx512(p, n, acc); return;
+        case simd_level::avx2:   finite_avx2(p, n, acc);   return;
+        case simd_level::ssse3:
+        case simd_level::sse2:   finite_sse2(p, n, acc);   return;
+        default: break;
+      }
+    }
+    #endif // DEBUGPRINTER_SIMD_X86
+    finite_scalar(p, n, 0, acc);
+  }
+  template <typename R>
+  static void scan_finite(const R & r, finite_acc & acc, std::true_type) {
+    scan_finite(r.data(), static_cast<std::size_t>(r.size()), acc);
+  }
+  template <typename R>
+  static void scan_finite(const R & r, finite_acc & acc, std::false_type) {
+    acc.count = static_cast<std::size_t>(std::distance(std::begin(r), std::end(r)));
+    finite_scalar(std::begin(r), acc.count, 0, acc);
+  }
+  template <typename T, std::size_t N>
+  static void scan_finite(const T (&r)[N], finite_acc & acc, std::false_type) {
+    scan_finite(static_cast<const T *>(r), N, acc);
+  }
+  template <typename T>
+  static void scan_finite(const StridedView<T> & r, finite_acc & acc,
+                          std::true_type) {
+    if(r.stride() == 1)
+      return scan_finite(r.data(), r.size(), acc);
+    acc.count = r.size();
+    finite_scalar(r.begin(), r.size(), 0, acc);
+  }
+
+  bool report_finite(const std::string & label, const finite_acc & acc) const {
+    if(acc.bad == 0)
+      return true;
+    std::ostream & out = line_start();
+    out << hcol_ << label << ": " << hcol_r_ << acc.bad << " of " << acc.count
+        << " values not finite, first @" << acc.first << " = " << acc.value
+        << std::endl;
+    stack();
+    return false;
+  }
+
+  // Result of dout_DIFF, errors are |a - b| and |a - b| / |b|
+  struct diff_acc {
+    std::size_t bad = 0, first = 0, iabs = 0, irel = 0;
+    double maxabs = 0, maxrel = 0;
+    void add_max(const double e, const std::size_t i,
+                 const double r, const std::size_t j) noexcept {
+      if(e > maxabs || (e == maxabs && e != 0 && i < iabs)) {
+        maxabs = e;
+        iabs = i;
+      }
+      if(r > maxrel || (r == maxrel && r != 0 && j < irel)) {
+        maxrel = r;
+        irel = j;
+      }
+    }
+  };
+
+  // float only if both sides are float
+  template <typename T, typename U>
+  using diff_compute_t = std::conditional_t<
+    std::is_same<T, float>::value && std::is_same<U, float>::value, float, double>;
+
+  template <typename C>
+  static bool diff_match(const C x, const C y, const C atol, const C rtol) noexcept {
+    return x == y || std::abs(x - y) <= atol + rtol * std::abs(y);
+  }
+
+  template <typename C, typename Ia, typename Ib>
+  static void diff_scalar(Ia ia, Ib ib, const std::size_t n, const std::size_t i0,
+                          const C atol, const C rtol, diff_acc & acc) {
+    for(std::size_t i = 0; i < n; ++i, ++ia, ++ib) {
+      const C x = static_cast<C>(*ia), y = static_cast<C>(*ib);
+      if(!diff_match(x, y, atol, rtol) && acc.bad++ == 0)
+        acc.first = i0 + i;
+      const C e = std::abs(x - y);
+      acc.add_max(static_cast<double>(e), i0 + i,
+                  static_cast<double>(e / std::abs(y)), i0 + i);
+    }
+  }
+
+  #ifdef DEBUGPRINTER_SIMD_X86
+  // Same as diff_scalar, first is only narrowed down to the block
+  template <typename T, typename U, typename C, std::size_t B>
+  __attribute__((always_inline)) static inline
+  void diff_simd(const T * a, const U * b, const std::size_t n,
+                 const C atol, const C rtol, diff_acc & acc) {
+    using V = typename simd_vec<C, B>::type;
+    using M = decltype(V() < V());
+    constexpr std::size_t W = B / sizeof(C);
+    using La = typename simd_vec<T, W * sizeof(T)>::type;
+    using Lb = typename simd_vec<U, W * sizeof(U)>::type;
+    constexpr std::size_t block = 4096;
+
+    using I = std::remove_reference_t<decltype(M()[0])>;
+    M iota;
+    for(std::size_t l = 0; l < W; ++l) iota[l] = static_cast<I>(l);
+    const V vatol = V() + atol, vrtol = V() + rtol;
+
+    std::size_t i = 0;
+    while(n - i >= W) {
+      const std::size_t len = std::min(block, (n - i) / W * W);
+      V vabs = V(), vrel = V();
+      M iabs = M(), irel = M(), cbad = M();
+      M idx = iota;
+      for(std::size_t j = 0; j < len; j += W, idx += static_cast<I>(W)) {
+        La ra;
+        Lb rb;
+        std::memcpy(&ra, a + i + j, sizeof ra);
+        std::memcpy(&rb, b + i + j, sizeof rb);
+        const V x = __builtin_convertvector(ra, V);
+        const V y = __builtin_convertvector(rb, V);
+        const V d = x - y;
+        const V e = d < V() ? -d : d;
+        const V ay = y < V() ? -y : y;
+        const V r = e / ay;                  // NaN for 0 / 0, never the max
+        cbad -= (((x == y) | (e <= vatol + vrtol * ay)) == M());
+        const M ga = e > vabs, gr = r > vrel;
+        vabs = ga ? e : vabs;
+        iabs = ga ? idx : iabs;
+        vrel = gr ? r : vrel;
+        irel = gr ? idx : irel;
+      }
+      std::size_t nbad = 0;
+      for(std::size_t l = 0; l < W; ++l) {
+        nbad += static_cast<std::size_t>(cbad[l]);
+        acc.add_max(static_cast<double>(vabs[l]), i + static_cast<std::size_t>(iabs[l]),
+                    static_cast<double>(vrel[l]), i + static_cast<std::size_t>(irel[l]));
+      }
+      if(nbad != 0 && acc.bad == 0)
+        acc.first = i;
+      acc.bad += nbad;
+      i += len;
+    }
+    diff_scalar(a + i, b + i, n - i, i, atol, rtol, acc);
+  }
+
+  template <typename T, typename U, typename C>
+  __attribute__((target("avx512f")))
+  static void diff_avx512(const T * a, const U * b, std::size_t n,
+                          C atol, C rtol, diff_acc & acc) {
+    diff_simd<T, U, C, 64>(a, b, n, atol, rtol, acc);
+  }
+  template <typename T, typename U, typename C>
+  __attribute__((target("avx2")))
+  static void diff_avx2(const T * a, const U * b, std::size_t n,
+                        C atol, C rtol, diff_acc & acc) {
+    diff_simd<T, U, C, 32>(a, b, n, atol, rtol, acc);
+  }
+  template <typename T, typename U, typename C>
+  static void diff_sse2(const T * a, const U * b, std::size_t n,
+                        C atol, C rtol, diff_acc & acc) {
+    diff_simd<T, U, C, 16>(a, b, n, atol, rtol, acc);
+  }
+  #endif // DEBUGPRINTER_SIMD_X86
+
+  // Ranges stored as plain arrays (StridedView only if unit stride, checked later)
+  template <typename R>
+  struct is_flat : std::integral_constant<bool,
+    std::is_array<R>::value || is_contiguous_impl<R>::type::value> {};
+  template <typename T>
+  struct is_flat<StridedView<T>> : std::false_type {};
+
+  template <typename A, typename B, typename C>
+  static void diff_scan(const A & a, const B & b, const std::size_t n,
+                        const C atol, const C rtol, diff_acc & acc,
+                        std::false_type) {
+    diff_scalar(std::begin(a), std::begin(b), n, 0, atol, rtol, acc);
+  }
+  template <typename A, typename B, typename C>
+  static void diff_scan(const A & a, const B & b, const std::size_t n,
+                        const C atol, const C rtol, diff_acc & acc,
+                        std::true_type) {
+    if(n == 0) return;                           // no element to point to
+    const auto * pa = &*std::begin(a);
+    const auto * pb = &*std::begin(b);
+    #ifdef DEBUGPRINTER_SIMD_X86
+    using T = std::remove_cv_t<std::remove_reference_t<decltype(*pa)>>;
+    using U = std::remove_cv_t<std::remove_reference_t<decltype(*pb)>>;
+    if(!std::is_void<simd_compute_t<T>>::value
+       && !std::is_void<simd_compute_t<U>>::value) {
+      switch(simd()) {
+        case simd_level::avx512: diff_avx512(pa, pb, n, atol, rtol, acc); return;
+        case simd_level::avx2:   diff_avx2(pa, pb, n, atol, rtol, acc);   return;
+        case simd_level::ssse3:
+        case simd_level::sse2:   diff_sse2(pa, pb, n, atol, rtol, acc);   return;
+        default: break;
+      }
+    }
+    #endif // DEBUGPRINTER_SIMD_X86
+    diff_scalar(pa, pb, n, 0, atol, rtol, acc);
+  }
+
+  // Mismatching values starting at acc.first, within the element budget
+  template <typename Ia, typename Ib, typename C>
+  void diff_list(std::ostream & out, Ia ia, Ib ib, const std::size_t n,
+                 const diff_acc & acc, const C atol, const C rtol) const {
+    std::advance(ia, static_cast<std::ptrdiff_t>(acc.first));
+    std::advance(ib, static_cast<std::ptrdiff_t>(acc.first));
+    std::size_t shown = 0;
+    for(std::size_t i = acc.first; i < n; ++i, ++ia, ++ib) {
+      const C x = static_cast<C>(*ia), y = static_cast<C>(*ib);
+      if(diff_match(x, y, atol, rtol))
+        continue;
+      if(max_elem_ != 0 && shown == max_elem_) {
+        out << "  ... (" << acc.bad - shown << " more)" << std::endl;
+        return;
+      }
+      out << "  @" << i << ": " << +*ia << " vs " << +*ib
+          << "  diff=" << x - y << std::endl;
+      ++shown;
+    }
+  }
+
+  // Fingerprint of dout_HASH: 8 lanes of 64 bit, each 64 byte stripe adds
+  // v + lo32(v ^ key) * hi32(v ^ key) per lane, lanes are scrambled after
+  // every 16 stripes and folded at the end (XXH3-like, not cryptographic)
+  struct hash_state {
+    static constexpr std::size_t block = 1024;
+    std::uint64_t acc[8];
+    unsigned char buf[block];
+    std::size_t fill = 0, len = 0;
+    hash_state() noexcept { std::memcpy(acc, hash_key(), sizeof acc); }
+  };
+
+  static const std::uint64_t * hash_key() noexcept {
+    static const std::uint64_t key[8] = {
+      0x9e3779b185ebca87ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull,
+      0x85ebca77c2b2ae63ull, 0x27d4eb2f165667c5ull, 0xff51afd7ed558ccdull,
+      0xc4ceb9fe1a85ec53ull, 0x2545f4914f6cdd1dull};
+    return key;
+  }
+
+  static std::uint64_t hash_mix(std::uint64_t h) noexcept {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    return h ^ (h >> 33);
+  }
+
+  static void hash_stripe(std::uint64_t * acc, const unsigned char * p) noexcept {
+    const std::uint64_t * key = hash_key();
+    for(std::size_t l = 0; l < 8; ++l) {
+      std::uint64_t v;
+      std::memcpy(&v, p + 8 * l, sizeof v);
+      const std::uint64_t dk = v ^ key[l];
+      acc[l] += v + (dk & 0xffffffffu) * (dk >> 32);
+    }
+  }
+
+  static void hash_blocks_scalar(std::uint64_t * acc, const unsigned char * p,
+                                 const std::size_t blocks) noexcept {
+    const std::uint64_t * key = hash_key();
+    for(std::size_t b = 0; b < blocks; ++b) {
+      for(std::size_t s = 0; s < hash_state::block; s += 64)
+        hash_stripe(acc, p + b * hash_state::block + s);
+      for(std::size_t l = 0; l < 8; ++l)
+        acc[l] = ((acc[l] ^ (acc[l] >> 47)) ^ key[l]) * 0x9e3779b1u;
+    }
+  }
+
+  #ifdef DEBUGPRINTER_SIMD_X86
+  // Same as hash_blocks_scalar with the 8 lanes in 64 / B vectors
+  template <std::size_t B>
+  __attribute__((always_inline)) static inline
+  void hash_blocks_simd(std::uint64_t * acc, const unsigned char * p,
+                        const std::size_t blocks) noexcept {
+    using V = typename simd_vec<std::uint64_t, B>::type;
+    constexpr std::size_t K = 64 / B;
+    V a[K], k[K];
+    for(std::size_t j = 0; j < K; ++j) {
+      std::memcpy(&a[j], acc + j * B / 8, B);
+      std::memcpy(&k[j], hash_key() + j * B / 8, B);
+    }
+    for(std::size_t b = 0; b < blocks; ++b) {
+      for(std::size_t s = 0; s < hash_state::block; s += 64) {
+        for(std::size_t j = 0; j < K; ++j) {
+          V v;
+          std::memcpy(&v, p + b * hash_state::block + s + j * B, B);
+          const V dk = v ^ k[j];
+          a[j] += v + (dk & 0xffffffffu) * (dk >> 32);
+        }
+      }
+      for(std::size_t j = 0; j < K; ++j)
+        a[j] = ((a[j] ^ (a[j] >> 47)) ^ k[j]) * 0x9e3779b1u;
+    }
+    for(std::size_t j = 0; j < K; ++j)
+      std::memcpy(acc + j * B / 8, &a[j], B);
+  }
+
+  __attribute__((target("avx512f")))
+  static void hash_blocks_avx512(std::uint64_t * acc, const unsigned char * p,
+                                 std::size_t blocks) noexcept {
+    hash_blocks_simd<64>(acc, p, blocks);
+  }
+  __attribute__((target("avx2")))
+  static void hash_blocks_avx2(std::uint64_t * acc, const unsigned char * p,
+                               std::size_t blocks) noexcept {
+    hash_blocks_simd<32>(acc, p, blocks);
+  }
+  static void hash_blocks_sse2(std::uint64_t * acc, const unsigned char * p,
+                               std::size_t blocks) noexcept {
+    hash_blocks_simd<16>(acc, p, blocks);
+  }
+  #endif // DEBUGPRINTER_SIMD_X86
+
+  static void hash_blocks(std::uint64_t * acc, const unsigned char * p,
+                          const std::size_t blocks) noexcept {
+    switch(simd()) {
+      #ifdef DEBUGPRINTER_SIMD_X86
+      case simd_level::avx512: hash_blocks_avx512(acc, p, blocks); break;
+      case simd_level::avx2:   hash_blocks_avx2(acc, p, blocks);   break;
+      case simd_level::ssse3:
+      case simd_level::sse2:   hash_blocks_sse2(acc, p, blocks);   break;
+      #endif // DEBUGPRINTER_SIMD_X86
+      default:                 hash_blocks_scalar(acc, p, blocks);
+    }
+  }
+
+  static void hash_update(hash_state & st, const void * data, std::size_t n) noexcept {
+    const unsigned char * p = static_cast<const unsigned char *>(data);
+    st.len += n;
+    if(st.fill != 0) {
+      const std::size_t take = std::min(n, hash_state::block - st.fill);
+      std::memcpy(st.buf + st.fill, p, take);
+      st.fill += take;
+      p += take;
+      n -= take;
+      if(st.fill < hash_state::block)
+        return;
+      hash_blocks(st.acc, st.buf, 1);
+      st.fill = 0;
+    }
+    const std::size_t blocks = n / hash_state::block;
+    hash_blocks(st.acc, p, blocks);
+    p += blocks * hash_state::block;
+    n -= blocks * hash_state::block;
+    std::memcpy(st.buf, p, n);
+    st.fill = n;
+  }
+
+  // hash_update() of a single element, through the block buffer
+  template <typename V>
+  static void hash_append(hash_state & st, const V & v) noexcept {
+    const unsigned char * p = reinterpret_cast<const unsigned char *>(&v);
+    for(std::size_t n = sizeof(V); n != 0;) {
+      const std::size_t take = std::min(n, hash_state::block - st.fill);
+      std::memcpy(st.buf + st.fill, p, take);
+      st.fill += take;
+      st.len += take;
+      p += take;
+      n -= take;
+      if(st.fill == hash_state::block) {
+        hash_blocks(st.acc, st.buf, 1);
+        st.fill = 0;
+      }
+    }
+  }
+
+  static std::uint64_t hash_final(hash_state & st) noexcept {
+    std::size_t i = 0;
+    for(; i + 64 <= st.fill; i += 64)
+      hash_stripe(st.acc, st.buf + i);
+    if(i < st.fill) {                        // zero padded, len tells apart
+      unsigned char last[64] = {};
+      std::memcpy(last, st.buf + i, st.fill - i);
+      hash_stripe(st.acc, last);
+    }
+    std::uint64_t h = st.len * 0x9e3779b185ebca87ull;
+    for(std::size_t l = 0; l < 8; ++l)
+      h = hash_mix(h ^ st.acc[l]);
+    return h;
+  }
+
+  // 0: contiguous range, 1: other range, 2: object
+  template <typename T>
+  using hash_kind = std::integral_constant<int,
+    is_range<T> ? (is_flat<T>::value ? 0 : 1) : 2>;
+
+  template <typename T>
+  static std::uint64_t fingerprint(const T & obj) {
+    hash_state st;
+    hash_feed(st, obj, hash_kind<T>());
+    return hash_final(st);
+  }
+  template <typename T>
+  static void hash_feed(hash_state & st, const T & r, std::integral_constant<int, 0>) {
+    static_assert(std::is_trivially_copyable<range_value_t<T>>::value,
+                  "DebugPrinter error: hash() needs trivially copyable elements");
+    if(std::begin(r) != std::end(r))
+      hash_update(st, &*std::begin(r), sizeof(range_value_t<T>)
+                  * static_cast<std::size_t>(std::distance(std::begin(r), std::end(r))));
+  }
+  template <typename T>
+  static void hash_feed(hash_state & st, const T & r, std::integral_constant<int, 1>) {
+    static_assert(std::is_trivially_copyable<range_value_t<T>>::value,
+                  "DebugPrinter error: hash() needs trivially copyable elements");
+    for(const auto & e : r)                      // by value: vector<bool> proxies
+      hash_append(st, static_cast<range_value_t<T>>(e));
+  }
+  template <typename T>
+  static void hash_feed(hash_state & st, const T & obj, std::integral_constant<int, 2>) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "DebugPrinter error: hash() needs a range or trivially copyable object");
+    hash_update(st, &obj, sizeof(obj));
+  }
+
+  template <typename T>
+  auto hash_bytes(const T & r) const -> std::enable_if_t<is_range<T>, std::size_t> {
+    return sizeof(range_value_t<T>) * range_size(r, typename has_size_impl<T>::type());
+  }
+  template <typename T>
+  auto hash_bytes(const T &) const -> std::enable_if_t<!is_range<T>, std::size_t> {
+    return sizeof(T);
+  }
+
+  void print_hash(const std::string & label, std::uint64_t h,
+                  const std::size_t bytes) const {
+    char hex[19] = "0x";
+    for(int i = 17; i >= 2; --i, h >>= 4)
+      hex[i] = "0123456789abcdef"[h & 0xf];
+    line_start() << hcol_ << label << ": " << hcol_r_ << hex << " (" << bytes
+                 << " bytes)" << std::endl;
+  }
+
+  // NumPy dtype strings, e.g. "<f8" for double on little endian machines
+  template <typename T>
+  struct is_complex : std::false_type {};
+  template <typename T>
+  struct is_complex<std::complex<T>> : std::true_type {};
+
+  static char npy_order(const std::size_t size) noexcept {
+    #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return size == 1 ? '|' : '>';
+    #else
+    return size == 1 ? '|' : '<';
+    #endif
+  }
+  template <typename T>
+  static std::string npy_descr(T *) {
+    const char kind = std::is_same<T, bool>::value ? 'b'
+                    : std::is_floating_point<T>::value ? 'f'
+                    : std::is_signed<T>::value ? 'i' : 'u';
+    return std::string(1, npy_order(sizeof(T))) + kind + std::to_string(sizeof(T));
+  }
+  template <typename T>
+  static std::string npy_descr(std::complex<T> *) {
+    return std::string(1, npy_order(2)) + "c" + std::to_string(2 * sizeof(T));
+  }
+
+  // Magic, version 1.0, header length and dict padded to 64 bytes (and to at
+  // least min_size bytes in total), descr is a Python literal
+  static std::string npy_header(const std::string & descr, const std::string & dims,
+                                const std::size_t min_size = 0) {
+    std::string dict = "{'descr': " + descr + ", 'fortran_order': False, "
+                       "'shape': " + dims + ", }";
+    if(10 + dict.size() < min_size)
+      dict.append(min_size - 11 - dict.size(), ' ');
+    dict.append(63 - (10 + dict.size()) % 64, ' ');
+    dict += '\n';
+    std::string header("\x93NUMPY\x01\x00", 8);
+    header += static_cast<char>(dict.size() & 0xff);
+    header += static_cast<char>(dict.size() >> 8);
+    return header + dict;
+  }
+
+  template <typename R>
+  static bool npy_write(std::FILE * file, const R & range, const std::size_t n,
+                        std::true_type) {
+    return n == 0 || std::fwrite(&*std::begin(range), sizeof(range_value_t<R>),
+                                 n, file) == n;
+  }
+  template <typename R>
+  static bool npy_write(std::FILE * file, const R & range, std::size_t,
+                        std::false_type) {
+    using T = range_value_t<R>;
+    T chunk[65536 / sizeof(T)];
+    std::size_t fill = 0;
+    for(const auto & x : range) {
+      chunk[fill++] = x;
+      if(fill == sizeof(chunk) / sizeof(T)) {
+        if(std::fwrite(chunk, sizeof(T), fill, file) != fill) return false;
+        fill = 0;
+      }
+    }
+    return std::fwrite(chunk, sizeof(T), fill, file) == fill;
+  }
+
+  // One xxd line: "%08x: " offset, hex groups, ASCII column (max 84 chars)
+  static constexpr std::size_t hex_line_max = 96;
+
+  static void hex16_scalar(const unsigned char * in, char * out) noexcept {
+    static const char digits[] = "0123456789abcdef";
+    for(std::size_t i = 0; i < 16; ++i) {
+      out[2 * i] = digits[in[i] >> 4];
+      out[2 * i + 1] = digits[in[i] & 0xf];
+    }
+  }
+
+  #ifdef DEBUGPRINTER_SIMD_X86
+  __attribute__((target("ssse3")))
+  static void hex16_ssse3(const unsigned char * in, char * out) noexcept {
+    const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                         '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m128i mask = _mm_set1_epi8(0xf);
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+    const __m128i hi = _mm_shuffle_epi8(digits,
+                                        _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+    const __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(v, mask));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_unpacklo_epi8(hi, lo));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16),
+                     _mm_unpackhi_epi8(hi, lo));
+  }
+  #endif // DEBUGPRINTER_SIMD_X86
+
+  static std::size_t hex_line(char * out, const unsigned char * in,
+                              const std::size_t n, const std::size_t offset,
+                              const unsigned group) noexcept {
+    static const char digits[] = "0123456789abcdef";
+    char * p = out;
+    const int width = static_cast<std::uint64_t>(offset) >> 32 ? 16 : 8;
+    for(int i = width - 1; i >= 0; --i)
+      *p++ = digits[(offset >> (4 * i)) & 0xf];
+    *p++ = ':';
+    *p++ = ' ';
+
+    unsigned char line[16] = {};
+    std::memcpy(line, in, n);
+    char hex[32];
+    #ifdef DEBUGPRINTER_SIMD_X86
+    if(simd() >= simd_level::ssse3) hex16_ssse3(line, hex);
+    else
+    #endif // DEBUGPRINTER_SIMD_X86
+    hex16_scalar(line, hex);
+
+    for(std::size_t g = 0; g < 16; g += group) {
+      const std::size_t len = g < n ? 2 * std::min<std::size_t>(group, n - g) : 0;
+      std::memcpy(p, hex + 2 * g, len);
+      std::memset(p + len, ' ', 2 * group + 1 - len);  // pad short last line
+      p += 2 * group + 1;
+    }
+    *p++ = ' ';
+    for(std::size_t i = 0; i < n; ++i)
+      *p++ = (line[i] >= 0x20 && line[i] < 0x7f) ? static_cast<char>(line[i]) : '.';
+    *p++ = '\n';
+    return static_cast<std::size_t>(p - out);
+  }
+
+  // Profiling (dout_TIMER and friends). Every use site registers once in the
+  // site_table of its kind. Threads accumulate into their own shard of slots
+  // (written by the owning thread only, read by report()); shards are merged
+  // into the retired totals when their thread exits.
+  struct profile_registry {
+    std::mutex mutex;
+    std::vector<void (*)(const DebugPrinter &)> reporters;
+    const DebugPrinter * exit_printer = nullptr;
+    std::atomic<bool> at_exit{true};
+    // set_report_interval()
+    std::thread ticker;
+    std::condition_variable wake;
+    double interval = 0;
+    const DebugPrinter * interval_printer = nullptr;
+  };
+
+  static profile_registry & profiling() {
+    static profile_registry * reg = [] {
+      profile_registry * r = new profile_registry;   // never destroyed
+      std::atexit(&report_at_exit);
+      return r;
+    }();
+    return *reg;
+  }
+
+  static void report_at_exit() {
+    if(trace_on().load(std::memory_order_acquire)) {
+      const DebugPrinter * d = nullptr;
+      {
+        std::lock_guard<std::mutex> lock(tracing().mutex);
+        d = tracing().printer;
+      }
+      if(d != nullptr)
+        d->trace_stop();
+      else
+        DebugPrinter().trace_stop();             // its printer is gone
+    }
+    profile_registry & reg = profiling();
+    std::unique_lock<std::mutex> lock(reg.mutex);
+    reg.interval = 0;
+    reg.wake.notify_all();
+    std::thread t = std::move(reg.ticker);
+    lock.unlock();
+    if(t.joinable())
+      t.join();
+    if(reg.at_exit && reg.exit_printer != nullptr)
+      reg.exit_printer->report();
+  }
+
+  static void report_periodically() {
+    profile_registry & reg = profiling();
+    std::unique_lock<std::mutex> lock(reg.mutex);
+    while(reg.interval > 0) {
+      const double period = reg.interval;
+      const auto next = std::chrono::steady_clock::now() +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(period));
+      if(reg.wake.wait_until(lock, next, [&] { return reg.interval != period; }))
+        continue;                                // changed or stopped
+      const DebugPrinter * d = reg.interval_printer;
+      lock.unlock();
+      d->report();
+      lock.lock();
+    }
+  }
+
+  // Increment of a slot field by its owning thread (no locked instruction)
+  template <typename T>
+  static void bump(std::atomic<T> & a, const T d) noexcept {
+    a.store(a.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+  }
+
+  struct site_info {
+    std::string label, file;
+    int line;
+  };
+
+  template <typename Slot>
+  class site_table {
+    public:
+      using value = typename Slot::value;
+      using rows = std::vector<std::pair<site_info, value>>;
+
+      static site_table & instance() {
+        static site_table * table = new site_table;  // never destroyed
+        return *table;
+      }
+
+      std::size_t add(const DebugPrinter & d, const std::string & label,
+                      const char * file, const int line) {
+        profile_registry & reg = profiling();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        if(reg.exit_printer == nullptr)
+          reg.exit_printer = &d;
+        if(sites_.size() == chunk * max_chunks)
+          throw std::runtime_error("DebugPrinter error: too many profiling sites");
+        sites_.push_back({label, d.detail_.filemacro_name(file), line});
+        retired_.emplace_back();
+        return sites_.size() - 1;
+      }
+
+      // Slot of the calling thread
+      Slot & local(const std::size_t id) {
+        thread_local owner own;
+        if(own.s == nullptr)
+          own.s = attach();
+        std::atomic<Slot *> & c = own.s->chunks[id / chunk];
+        Slot * p = c.load(std::memory_order_relaxed);
+        if(p == nullptr) {
+          p = new_chunk();
+          c.store(p, std::memory_order_release);
+        }
+        return p[id % chunk];
+      }
+
+      // Values of all sites, merged over all threads
+      rows snapshot() const {
+        std::lock_guard<std::mutex> lock(profiling().mutex);
+        rows r;
+        for(std::size_t id = 0; id < sites_.size(); ++id) {
+          value v = retired_[id];
+          for(const shard * s : shards_)
+            if(const Slot * p = s->chunks[id / chunk].load(std::memory_order_acquire))
+              v.merge(p[id % chunk].load());
+          r.emplace_back(sites_[id], v);
+        }
+        return r;
+      }
+
+    private:
+      static constexpr std::size_t chunk = 64, max_chunks = 1024,
+                                   cache_line = 64;
+
+      // The slots of a chunk on cache lines of their own. operator new only
+      // aligns to 16 bytes before C++17, so the chunk is aligned by hand and
+      // the allocation is kept in front of it.
+      static Slot * new_chunk() {
+        const std::size_t bytes =
+          (chunk * sizeof(Slot) + cache_line - 1) / cache_line * cache_line;
+        char * const raw = static_cast<char *>(::operator new(bytes + cache_line));
+        char * const p = raw + cache_line
+                       - reinterpret_cast<std::uintptr_t>(raw) % cache_line;
+        std::memcpy(p - sizeof(raw), &raw, sizeof(raw));
+        Slot * const s = reinterpret_cast<Slot *>(p);
+        for(std::size_t i = 0; i < chunk; ++i)
+          new(s + i) Slot;
+        return s;
+      }
+      static void delete_chunk(Slot * const s) noexcept {
+        if(s == nullptr) return;
+        for(std::size_t i = 0; i < chunk; ++i)
+          s[i].~Slot();
+        char * raw;
+        std::memcpy(&raw, reinterpret_cast<char *>(s) - sizeof(raw), sizeof(raw));
+        ::operator delete(raw);
+      }
+
+      struct shard {
+        std::atomic<Slot *> chunks[max_chunks];
+        shard() noexcept {
+          for(auto & c : chunks) c.store(nullptr, std::memory_order_relaxed);
+        }
+        ~shard() {
+          for(auto & c : chunks) delete_chunk(c.load(std::memory_order_relaxed));
+        }
+      };
+      struct owner {                           // thread_local, retires shard
+        shard * s = nullptr;
+        ~owner() { if(s != nullptr) instance().retire(s); }
+      };
+
+      site_table() {
+        profile_registry & reg = profiling();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.reporters.push_back(&report);
+      }
+
+      shard * attach() {
+        shard * s = new shard;
+        std::lock_guard<std::mutex> lock(profiling().mutex);
+        shards_.push_back(s);
+        return s;
+      }
+
+      void retire(shard * s) {
+        {
+          std::lock_guard<std::mutex> lock(profiling().mutex);
+          for(std::size_t id = 0; id < sites_.size(); ++id)
+            if(const Slot * p = s->chunks[id / chunk].load(std::memory_order_relaxed))
+              retired_[id].merge(p[id % chunk].load());
+          shards_.erase(std::find(shards_.begin(), shards_.end(), s));
+        }
+        delete s;
+      }
+
+      static void report(const DebugPrinter & d) {
+        Slot::print(d, instance().snapshot());
+      }
+
+      std::deque<site_info> sites_;
+      std::deque<value> retired_;
+      std::vector<shard *> shards_;
+  };
+
+  // Time source of dout_TIMER: invariant TSC (calibrated against steady_clock
+  // since the first site registered), steady_clock nanoseconds otherwise
+  struct tick_clock {
+    static std::uint64_t steady_ns() noexcept {
+      return static_cast<std::uint64_t>(std::chrono::duration_cast<
+        std::chrono::nanoseconds>(std::chrono::steady_clock::now()
+                                    .time_since_epoch()).count());
+    }
+
+    static bool tsc() noexcept {
+      #ifdef DEBUGPRINTER_TSC
+      static const bool invariant = [] {
+        unsigned a, b, c, d;
+        return __get_cpuid(0x80000007, &a, &b, &c, &d) && (d & (1u << 8));
+      }();
+      return invariant;
+      #else
+      return false;
+      #endif // DEBUGPRINTER_TSC
+    }
+
+    static std::uint64_t now() noexcept {
+      #ifdef DEBUGPRINTER_TSC
+      if(tsc()) return __rdtsc();
+      #endif // DEBUGPRINTER_TSC
+      return steady_ns();
+    }
+
+    // Cost of an empty timed region, subtracted from every measurement
+    static std::uint64_t overhead() noexcept {
+      static const std::uint64_t ovh = [] {
+        start();
+        std::uint64_t best = std::numeric_limits<std::uint64_t>::max();
+        for(int i = 0; i < 1000; ++i) {
+          const std::uint64_t t0 = now();
+          best = std::min(best, now() - t0);
+        }
+        return best;
+      }();
+      return ovh;
+    }
+
+    static std::uint64_t elapsed(const std::uint64_t start,
+                                 const std::uint64_t stop) noexcept {
+      const std::uint64_t d = stop - start;
+      return d > overhead() ? d - overhead() : 0;
+    }
+
+    static const std::pair<std::uint64_t, std::uint64_t> & start() noexcept {
+      static const std::pair<std::uint64_t, std::uint64_t> t0{now(), steady_ns()};
+      return t0;
+    }
+
+    // Calibrated over at least 10 ms since start()
+    static double ns_per_tick() noexcept {
+      if(!tsc()) return 1;
+      const auto & t0 = start();
+      std::uint64_t ticks, ns;
+      do {
+        ticks = now();
+        ns = steady_ns();
+      } while(ns - t0.second < 10000000);
+      return static_cast<double>(ns - t0.second)
+           / static_cast<double>(ticks - t0.first);
+    }
+  };
+
+  static std::uint64_t thread_cpu_ns() noexcept {
+    #ifdef CLOCK_THREAD_CPUTIME_ID
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000u
+         + static_cast<std::uint64_t>(ts.tv_nsec);
+    #else
+    return 0;
+    #endif // CLOCK_THREAD_CPUTIME_ID
+  }
+
+  // Sizes with 3 significant digits, e.g. "512 B", "1.50 MiB", "-4.00 KiB"
+  static std::string format_bytes(const std::int64_t bytes) {
+    static const char * const units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    double b = std::abs(static_cast<double>(bytes));
+    std::size_t u = 0;
+    for(; u < 4 && b >= 1023.5; ++u) b /= 1024;
+    char buf[32];
+    std::snprintf(buf, sizeof buf, u == 0 || b >= 99.95 ? "%s%.0f %s" : b >= 9.995
+                  ? "%s%.1f %s" : "%s%.2f %s", bytes < 0 ? "-" : "", b, units[u]);
+    return buf;
+  }
+
+  // dout_RUSAGE sample: getrusage(RUSAGE_THREAD) of the calling thread,
+  // resident set and I/O characters of the process; zero where unavailable
+  enum rusage_field : std::size_t {
+    ru_user, ru_sys, ru_minflt, ru_majflt, ru_vcsw, ru_ivcsw, ru_rss,
+    ru_rchar, ru_wchar, rusage_fields
+  };
+
+  static void rusage_read(std::uint64_t * v) noexcept {
+    std::fill(v, v + rusage_fields, std::uint64_t(0));
+    #ifdef RUSAGE_THREAD
+    rusage ru;
+    if(getrusage(RUSAGE_THREAD, &ru) == 0) {
+      auto ns = [](const timeval & t) {
+        return static_cast<std::uint64_t>(t.tv_sec) * 1000000000u
+             + static_cast<std::uint64_t>(t.tv_usec) * 1000u;
+      };
+      v[ru_user] = ns(ru.ru_utime);
+      v[ru_sys] = ns(ru.ru_stime);
+      v[ru_minflt] = static_cast<std::uint64_t>(ru.ru_minflt);
+      v[ru_majflt] = static_cast<std::uint64_t>(ru.ru_majflt);
+      v[ru_vcsw] = static_cast<std::uint64_t>(ru.ru_nvcsw);
+      v[ru_ivcsw] = static_cast<std::uint64_t>(ru.ru_nivcsw);
+    }
+    if(std::FILE * f = std::fopen("/proc/self/statm", "r")) {
+      unsigned long long size = 0, rss = 0;
+      if(std::fscanf(f, "%llu %llu", &size, &rss) == 2)
+        v[ru_rss] = rss * static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+      std::fclose(f);
+    }
+    if(std::FILE * f = std::fopen("/proc/self/io", "r")) {
+      unsigned long long rchar = 0, wchar = 0;
+      if(std::fscanf(f, "rchar: %llu wchar: %llu", &rchar, &wchar) == 2) {
+        v[ru_rchar] = rchar;
+        v[ru_wchar] = wchar;
+      }
+      std::fclose(f);
+    }
+    #endif // RUSAGE_THREAD
+  }
+
+  // Characters read by rusage_read() itself, between two samples
+  static std::uint64_t rusage_rchar_overhead() noexcept {
+    static const std::uint64_t overhead = [] {
+      std::uint64_t a[rusage_fields], b[rusage_fields];
+      rusage_read(a);
+      rusage_read(b);
+      return b[ru_rchar] - a[ru_rchar];
+    }();
+    return overhead;
+  }
+
+  // dout_PERF counters: the hardware events that can be opened, else the
+  // software ones. Chosen once per process, opened as one group per thread.
+  struct perf_event_kind {
+    std::uint32_t type;
+    std::uint64_t config;
+    const char * name;
+  };
+
+  static constexpr std::size_t perf_max_events = 4;
+
+  static const std::vector<perf_event_kind> & perf_events() {
+    static const std::vector<perf_event_kind> events = [] {
+      std::vector<perf_event_kind> hw, sw;
+      #ifdef DEBUGPRINTER_PERF
+      const perf_event_kind hw_all[] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles"},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions"},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "cache-misses"},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "branch-misses"}};
+      const perf_event_kind sw_all[] = {
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, "task-clock"},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS, "page-faults"},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, "ctx-switches"},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS, "migrations"}};
+      for(const perf_event_kind & e : hw_all) {
+        const int fd = perf_open(e, -1);
+        if(fd >= 0) {
+          hw.push_back(e);
+          ::close(fd);
+        }
+      }
+      for(const perf_event_kind & e : sw_all) {
+        const int fd = perf_open(e, -1);
+        if(fd >= 0) {
+          sw.push_back(e);
+          ::close(fd);
+        }
+      }
+      #endif // DEBUGPRINTER_PERF
+      return hw.empty() ? sw : hw;
+    }();
+    return events;
+  }
+
+  // Hardware events of user code only, software events including the kernel
+  // (context switches happen there)
+  static int perf_open(const perf_event_kind & e, const int group) noexcept {
+    #ifdef DEBUGPRINTER_PERF
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = e.type;
+    attr.config = e.config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = e.type == PERF_TYPE_HARDWARE;
+    attr.exclude_hv = 1;
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+    #else
+    static_cast<void>(e);
+    static_cast<void>(group);
+    return -1;
+    #endif // DEBUGPRINTER_PERF
+  }
+
+  // Counter group of the calling thread
+  class perf_group {
+    public:
+      static perf_group & local() {
+        thread_local perf_group g;
+        return g;
+      }
+
+      // Current values of perf_events(), false if the group is not open
+      bool read(std::uint64_t * values) const noexcept {
+        #ifdef DEBUGPRINTER_PERF
+        if(open_ == 0) return false;
+        std::uint64_t buf[1 + perf_max_events];
+        if(::read(fd_[0], buf, sizeof buf) < static_cast<long>(sizeof(std::uint64_t)))
+          return false;
+        for(std::size_t i = 0; i < perf_events().size(); ++i)
+          values[i] = pos_[i] < buf[0] ? buf[1 + pos_[i]] : 0;
+        return true;
+        #else
+        static_cast<void>(values);
+        return false;
+        #endif // DEBUGPRINTER_PERF
+      }
+
+    private:
+      perf_group() noexcept {
+        const std::vector<perf_event_kind> & events = perf_events();
+        for(std::size_t i = 0; i < events.size(); ++i) {
+          fd_[i] = perf_open(events[i], i == 0 ? -1 : fd_[0]);
+          pos_[i] = fd_[i] >= 0 ? open_++ : perf_max_events;
+          if(i == 0 && fd_[0] < 0) break;        // no leader, no group
+        }
+      }
+      ~perf_group() {
+        #ifdef DEBUGPRINTER_PERF
+        for(std::size_t i = 0; i < perf_max_events; ++i)
+          if(fd_[i] >= 0) ::close(fd_[i]);
+        #endif // DEBUGPRINTER_PERF
+      }
+      perf_group(const perf_group &) = delete;
+      perf_group & operator=(const perf_group &) = delete;
+
+      int fd_[perf_max_events] = {-1, -1, -1, -1};
+      std::size_t pos_[perf_max_events] = {};    // index in the read() data
+      std::size_t open_ = 0;
+  };
+
+  // Call of bench(), keeping the result alive
+  template <typename F>
+  static void bench_call(F & f, std::true_type) {
+    f();
+    clobber_memory();
+  }
+  template <typename F>
+  static void bench_call(F & f, std::false_type) {
+    do_not_optimize(f());
+    clobber_memory();
+  }
+
+  // Median of the bench() samples with its 95% confidence interval, from
+  // the order statistics around it (distribution free)
+  struct bench_stats {
+    double median = 0, lo = 0, hi = 0;
+  };
+  static bench_stats bench_median(std::vector<double> s) {
+    bench_stats st;
+    if(s.empty()) return st;
+    std::sort(s.begin(), s.end());
+    const std::size_t m = s.size();
+    const double w = 0.98 * std::sqrt(static_cast<double>(m));
+    st.median = m % 2 ? s[m / 2] : (s[m / 2 - 1] + s[m / 2]) / 2;
+    st.lo = s[static_cast<std::size_t>(std::max(1., std::floor(m / 2. - w))) - 1];
+    st.hi = s[std::min(m - 1, static_cast<std::size_t>(std::ceil(m / 2. + w)))];
+    return st;
+  }
+
+  // Durations with 3 significant digits, e.g. "52.1 ns", "1.20 ms"
+  static std::string format_ns(double ns) {
+    static const char * const units[] = {"ns", "us", "ms", "s"};
+    std::size_t u = 0;
+    for(; u < 3 && ns >= 999.5; ++u) ns /= 1000;
+    char buf[32];
+    std::snprintf(buf, sizeof buf, ns >= 99.95 ? "%.0f %s" : ns >= 9.995
+                  ? "%.1f %s" : "%.2f %s", ns, units[u]);
+    return buf;
+  }
+
+  // Per-thread statistics of one dout_TIMER site, in ticks
+  struct timer_slot {
+    struct value {
+      std::uint64_t count = 0, ticks = 0, cpu_ns = 0;
+      std::uint64_t min = std::numeric_limits<std::uint64_t>::max(), max = 0;
+      void merge(const value & o) noexcept {
+        count += o.count;
+        ticks += o.ticks;
+        cpu_ns += o.cpu_ns;
+        min = std::min(min, o.min);
+        max = std::max(max, o.max);
+      }
+    };
+
+    std::atomic<std::uint64_t> count{0}, ticks{0}, cpu_ns{0};
+    std::atomic<std::uint64_t> min{std::numeric_limits<std::uint64_t>::max()};
+    std::atomic<std::uint64_t> max{0};
+
+    void record(const std::uint64_t t, const std::uint64_t cpu) noexcept {
+      bump(count, std::uint64_t(1));
+      bump(ticks, t);
+      bump(cpu_ns, cpu);
+      if(t < min.load(std::memory_order_relaxed))
+        min.store(t, std::memory_order_relaxed);
+      if(t > max.load(std::memory_order_relaxed))
+        max.store(t, std::memory_order_relaxed);
+    }
+
+    value load() const noexcept {
+      value v;
+      v.count = count.load(std::memory_order_relaxed);
+      v.ticks = ticks.load(std::memory_order_relaxed);
+      v.cpu_ns = cpu_ns.load(std::memory_order_relaxed);
+      v.min = min.load(std::memory_order_relaxed);
+      v.max = max.load(std::memory_order_relaxed);
+      return v;
+    }
+
+    static void print(const DebugPrinter & d,
+                      site_table<timer_slot>::rows rows) {
+      rows.erase(std::remove_if(rows.begin(), rows.end(),
+                   [](const auto & r) { return r.second.count == 0; }), rows.end());
+      if(rows.empty()) return;
+      std::stable_sort(rows.begin(), rows.end(), [](const auto & a, const auto & b) {
+        return a.second.ticks > b.second.ticks;
+      });
+      const double scale = tick_clock::ns_per_tick();
+      bool cpu = false;
+      for(const auto & r : rows) cpu |= r.second.cpu_ns != 0;
+
+      std::ostream & out = *d.outstream;
+      out << d.hcol_ << "DebugPrinter timers:" << d.hcol_r_ << std::endl;
+      out << std::setw(10) << "count" << std::setw(11) << "total"
+          << std::setw(11) << "mean" << std::setw(11) << "min"
+          << std::setw(11) << "max";
+      if(cpu) out << std::setw(11) << "cpu/call";
+      out << "  site" << std::endl;
+      for(const auto & r : rows) {
+        const value & v = r.second;
+        const double n = static_cast<double>(v.count);
+        out << std::setw(10) << v.count
+            << std::setw(11) << format_ns(scale * static_cast<double>(v.ticks))
+            << std::setw(11) << format_ns(scale * static_cast<double>(v.ticks) / n)
+            << std::setw(11) << format_ns(scale * static_cast<double>(v.min))
+            << std::setw(11) << format_ns(scale * static_cast<double>(v.max));
+        if(cpu) out << std::setw(11) << (v.cpu_ns == 0 ? "-"
+                                         : format_ns(static_cast<double>(v.cpu_ns) / n));
+        out << "  " << r.first.label << " (" << r.first.file << ":"
+            << r.first.line << ")" << std::endl;
+      }
+    }
+  };
+
+  // Timeline of trace_start(). Every thread appends to its own buffer of
+  // fixed-size blocks and publishes the size; buffers of exited threads are
+  // kept until they are written.
+  struct trace_event {
+    std::uint64_t tick, flow;
+    double value;                                // counter events
+    std::uint32_t name;                          // trace_registry::names
+    char kind;                                   // Chrome phase: B, E, i, C, s, f
+  };
+
+  // The owner rewinds its buffer (keeping the blocks) on its first event
+  // of a new trace_start() generation.
+  struct trace_buffer {
+    static constexpr std::size_t block = 4096, max_blocks = 4096;
+    std::atomic<trace_event *> blocks[max_blocks];
+    std::atomic<std::size_t> size{0}, dropped{0};
+    std::atomic<std::uint32_t> generation{0};   // published after the rewind
+    std::size_t open = 0, skipped = 0;           // kept and dropped open B
+    const std::uint32_t tid = trace_tid();
+    bool exited = false;
+
+    trace_buffer() {
+      for(auto & b : blocks) b.store(nullptr, std::memory_order_relaxed);
+    }
+    ~trace_buffer() {
+      for(auto & b : blocks) delete[] b.load(std::memory_order_relaxed);
+    }
+    trace_buffer(const trace_buffer &) = delete;
+    trace_buffer & operator=(const trace_buffer &) = delete;
+
+    // Owner only, drops events beyond block * max_blocks. Room is kept for
+    // the E of every kept B, and the E of a dropped B is dropped too.
+    void append(const char kind, const std::uint32_t name, const double value = 0,
+                const std::uint64_t flow = flow_local()) {
+      const std::uint32_t g = trace_generation().load(std::memory_order_acquire);
+      if(generation.load(std::memory_order_relaxed) != g) {
+        size.store(0, std::memory_order_relaxed);
+        dropped.store(0, std::memory_order_relaxed);
+        open = skipped = 0;
+        generation.store(g, std::memory_order_release);
+      }
+      const std::size_t n = size.load(std::memory_order_relaxed);
+      const std::size_t need = kind == 'E' ? 1 : open + (kind == 'B' ? 2 : 1);
+      if((kind == 'E' && skipped != 0) || n + need > block * max_blocks) {
+        if(kind == 'E') --skipped;
+        else if(kind == 'B') ++skipped;
+        bump(dropped, std::size_t(1));
+        return;
+      }
+      if(kind == 'B') ++open;
+      else if(kind == 'E' && open != 0) --open;
+      std::atomic<trace_event *> & b = blocks[n / block];
+      trace_event * p = b.load(std::memory_order_relaxed);
+      if(p == nullptr) {
+        p = new trace_event[block];
+        b.store(p, std::memory_order_release);
+      }
+      p[n % block] = {tick_clock::now(), flow, value, name, kind};
+      size.store(n + 1, std::memory_order_release);
+    }
+    const trace_event & at(const std::size_t i) const noexcept {
+      return blocks[i / block].load(std::memory_order_acquire)[i % block];
+    }
+  };
+
+  struct trace_registry {
+    std::mutex mutex;
+    std::vector<std::string> names;              // JSON-escaped
+    std::vector<trace_buffer *> buffers;
+    std::uint64_t start = 0;
+    std::string path;
+    const DebugPrinter * printer = nullptr;
+
+    void erase_exited() {
+      for(trace_buffer *& b : buffers)
+        if(b->exited) {
+          delete b;
+          b = nullptr;
+        }
+      buffers.erase(std::remove(buffers.begin(), buffers.end(), nullptr),
+                    buffers.end());
+    }
+
+    bool write(std::size_t & events, std::size_t & dropped) const {
+      const std::uint32_t g = trace_generation().load(std::memory_order_relaxed);
+      std::FILE * f = std::fopen(path.c_str(), "w");
+      if(f == nullptr) return false;
+      const double us = tick_clock::ns_per_tick() / 1000;
+      std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", f);
+      const char * sep = "";
+      for(const trace_buffer * b : buffers) {
+        if(b->generation.load(std::memory_order_acquire) != g) continue;
+        const std::size_t size = b->size.load(std::memory_order_acquire);
+        dropped += b->dropped.load(std::memory_order_relaxed);
+        if(size == 0) continue;
+        std::fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                     "\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+                     sep, b->tid, b->tid);
+        sep = ",\n";
+        for(std::size_t i = 0; i < size; ++i) {
+          const trace_event & e = b->at(i);
+          const double ts = e.tick > start ? us * static_cast<double>(e.tick - start) : 0;
+          std::fprintf(f, ",\n{\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u",
+                       e.kind, ts, b->tid);
+          if(e.kind != 'E')
+            std::fprintf(f, ",\"name\":\"%s\"", names[e.name].c_str());
+          if(e.kind == 'i')
+            std::fputs(",\"s\":\"t\"", f);
+          if(e.kind == 's' || e.kind == 'f')
+            std::fprintf(f, ",\"cat\":\"flow\",\"id\":%llu%s",
+                         static_cast<unsigned long long>(e.flow),
+                         e.kind == 'f' ? ",\"bp\":\"e\"" : "");
+          else if(e.kind == 'C')
+            std::fprintf(f, ",\"args\":{\"value\":%.17g}", e.value);
+          else if(e.kind != 'E' && e.flow != 0)
+            std::fprintf(f, ",\"args\":{\"flow\":%llu}",
+                         static_cast<unsigned long long>(e.flow));
+          std::fputc('}', f);
+          ++events;
+        }
+      }
+      instrument_write(f, *this, sep, events, dropped);
+      std::fputs("\n]}\n", f);
+      return std::fclose(f) == 0;
+    }
+  };
+
+  static trace_registry & tracing() {
+    static trace_registry * reg = new trace_registry;  // never destroyed
+    return *reg;
+  }
+
+  static std::atomic<bool> & trace_on() noexcept {
+    static std::atomic<bool> on{false};
+    return on;
+  }
+
+  // Track of the calling thread in the timeline, also of its
+  // DEBUGPRINTER_INSTRUMENT calls (lock-free for the hooks)
+  static std::uint32_t trace_tid() noexcept {
+    static std::atomic<std::uint32_t> threads{0};
+    thread_local std::uint32_t tid = 0;
+    if(tid == 0)
+      tid = threads.fetch_add(1, std::memory_order_relaxed) + 1;
+    return tid;
+  }
+
+  // Number of trace_start() calls, see trace_buffer
+  static std::atomic<std::uint32_t> & trace_generation() noexcept {
+    static std::atomic<std::uint32_t> generation{0};
+    return generation;
+  }
+
+  static std::string json_escape(const std::string & name) {
+    std::string json;
+    for(const char c : name) {
+      if(c == '"' || c == '\\') json += '\\';
+      if(static_cast<unsigned char>(c) >= 0x20) json += c;
+    }
+    return json;
+  }
+
+  static std::uint32_t trace_name(const std::string & name) {
+    const std::string json = json_escape(name);
+    trace_registry & reg = tracing();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.names.push_back(json);
+    return static_cast<std::uint32_t>(reg.names.size() - 1);
+  }
+
+  // Buffer of the calling thread
+  static trace_buffer & trace_local() {
+    struct owner {
+      trace_buffer * b = nullptr;
+      ~owner() {
+        if(b == nullptr) return;
+        std::lock_guard<std::mutex> lock(tracing().mutex);
+        b->exited = true;
+      }
+    };
+    thread_local owner own;
+    if(own.b == nullptr) {
+      trace_registry & reg = tracing();
+      std::lock_guard<std::mutex> lock(reg.mutex);
+      own.b = new trace_buffer;
+      reg.buffers.push_back(own.b);
+    }
+    return *own.b;
+  }
+
+  // Flow ID of the calling thread, see flow()
+  static std::uint64_t & flow_local() noexcept {
+    thread_local std::uint64_t id = 0;
+    return id;
+  }
+
+  static std::uint32_t trace_flow_name() {
+    static const std::uint32_t name = trace_name("flow");
+    return name;
+  }
+
+  static void trace(const char kind, const std::uint32_t name, const double value = 0) {
+    if(trace_on().load(std::memory_order_relaxed))
+      trace_local().append(kind, name, value);
+  }
+
+  // Per-thread value of one dout_COUNT site. Neighbouring slots in a chunk
+  // belong to the same thread and chunks are cache-line aligned (see
+  // site_table::new_chunk), so there is no false sharing to pad against.
+  struct count_slot {
+    struct value {
+      std::uint64_t count = 0;
+      void merge(const value & o) noexcept { count += o.count; }
+    };
+
+    std::atomic<std::uint64_t> count{0};
+
+    value load() const noexcept {
+      value v;
+      v.count = count.load(std::memory_order_relaxed);
+      return v;
+    }
+
+    static void print(const DebugPrinter & d,
+                      site_table<count_slot>::rows rows) {
+      rows.erase(std::remove_if(rows.begin(), rows.end(),
+                   [](const auto & r) { return r.second.count == 0; }), rows.end());
+      if(rows.empty()) return;
+      std::stable_sort(rows.begin(), rows.end(), [](const auto & a, const auto & b) {
+        return a.second.count > b.second.count;
+      });
+      std::ostream & out = *d.outstream;
+      out << d.hcol_ << "DebugPrinter counters:" << d.hcol_r_ << std::endl;
+      for(const auto & r : rows)
+        out << std::setw(14) << r.second.count << "  " << r.first.label << " ("
+            << r.first.file << ":" << r.first.line << ")" << std::endl;
+    }
+  };
+
+  // Per-thread sums of one dout_PERF site, counters as in perf_events()
+  struct perf_slot {
+    struct value {
+      std::uint64_t count = 0, ticks = 0, read = 0;  // read: passes with counters
+      std::uint64_t events[perf_max_events] = {};
+      void merge(const value & o) noexcept {
+        count += o.count;
+        ticks += o.ticks;
+        read += o.read;
+        for(std::size_t i = 0; i < perf_max_events; ++i) events[i] += o.events[i];
+      }
+    };
+
+    std::atomic<std::uint64_t> count{0}, ticks{0}, read{0};
+    std::atomic<std::uint64_t> events[perf_max_events];
+
+    perf_slot() noexcept {
+      for(auto & e : events) e.store(0, std::memory_order_relaxed);
+    }
+
+    void record(const std::uint64_t t, const std::uint64_t * start,
+                const std::uint64_t * stop) noexcept {
+      bump(count, std::uint64_t(1));
+      bump(ticks, t);
+      if(start == nullptr) return;
+      bump(read, std::uint64_t(1));
+      for(std::size_t i = 0; i < perf_max_events; ++i)
+        bump(events[i], stop[i] - start[i]);
+    }
+
+    value load() const noexcept {
+      value v;
+      v.count = count.load(std::memory_order_relaxed);
+      v.ticks = ticks.load(std::memory_order_relaxed);
+      v.read = read.load(std::memory_order_relaxed);
+      for(std::size_t i = 0; i < perf_max_events; ++i)
+        v.events[i] = events[i].load(std::memory_order_relaxed);
+      return v;
+    }
+
+    static void print(const DebugPrinter & d,
+                      site_table<perf_slot>::rows rows) {
+      rows.erase(std::remove_if(rows.begin(), rows.end(),
+                   [](const auto & r) { return r.second.count == 0; }), rows.end());
+      if(rows.empty()) return;
+      std::stable_sort(rows.begin(), rows.end(), [](const auto & a, const auto & b) {
+        return a.second.ticks > b.second.ticks;
+      });
+      const std::vector<perf_event_kind> & events = perf_events();
+      auto find = [&](const char * name) {
+        for(std::size_t i = 0; i < events.size(); ++i)
+          if(std::strcmp(events[i].name, name) == 0) return i;
+        return perf_max_events;
+      };
+      const std::size_t cycles = find("cycles"), instr = find("instructions");
+      const std::size_t cache = find("cache-misses"), branch = find("branch-misses");
+      const std::size_t clock = find("task-clock");
+      auto format = [](const double v) {
+        char buf[32];
+        std::snprintf(buf, sizeof buf, "%.4g", v);
+        return std::string(buf);
+      };
+
+      std::ostream & out = *d.outstream;
+      out << d.hcol_ << "DebugPrinter perf counters"
+          << (events.empty() ? " (not available)" : " per call")
+          << ":" << d.hcol_r_ << std::endl;
+      out << std::setw(10) << "count" << std::setw(11) << "mean";
+      for(const perf_event_kind & e : events) out << std::setw(14) << e.name;
+      if(instr < perf_max_events) {
+        if(cycles < perf_max_events) out << std::setw(7) << "IPC";
+        if(cache < perf_max_events) out << std::setw(10) << "cache/ki";
+        if(branch < perf_max_events) out << std::setw(10) << "branch/ki";
+      }
+      out << "  site" << std::endl;
+      const double scale = tick_clock::ns_per_tick();
+      for(const auto & r : rows) {
+        const value & v = r.second;
+        const double n = static_cast<double>(v.read);
+        auto ev = [&](const std::size_t i) { return static_cast<double>(v.events[i]); };
+        out << std::setw(10) << v.count << std::setw(11)
+            << format_ns(scale * static_cast<double>(v.ticks) / static_cast<double>(v.count));
+        for(std::size_t i = 0; i < events.size(); ++i)
+          out << std::setw(14) << (v.read == 0 ? "-"
+                                  : i == clock ? format_ns(ev(i) / n) : format(ev(i) / n));
+        if(instr < perf_max_events) {
+          const double ki = ev(instr) / 1000;
+          if(cycles < perf_max_events)
+            out << std::setw(7) << (ev(cycles) > 0 ? format(ev(instr) / ev(cycles)) : "-");
+          if(cache < perf_max_events)
+            out << std::setw(10) << (ki > 0 ? format(ev(cache) / ki) : "-");
+          if(branch < perf_max_events)
+            out << std::setw(10) << (ki > 0 ? format(ev(branch) / ki) : "-");
+        }
+        out << "  " << r.first.label << " (" << r.first.file << ":"
+            << r.first.line << ")" << std::endl;
+      }
+    }
+  };
+
+  // Per-thread sums of one dout_RUSAGE site over the sampled passes. The rss
+  // deltas are signed, summed modulo 2^64.
+  struct rusage_slot {
+    struct value {
+      std::uint64_t count = 0, sampled = 0, ticks = 0;
+      std::uint64_t fields[rusage_fields] = {};
+      void merge(const value & o) noexcept {
+        count += o.count;
+        sampled += o.sampled;
+        ticks += o.ticks;
+        for(std::size_t i = 0; i < rusage_fields; ++i) fields[i] += o.fields[i];
+      }
+    };
+
+    std::atomic<std::uint64_t> count{0}, sampled{0}, ticks{0};
+    std::atomic<std::uint64_t> fields[rusage_fields];
+
+    rusage_slot() noexcept {
+      for(auto & f : fields) f.store(0, std::memory_order_relaxed);
+    }
+
+    value load() const noexcept {
+      value v;
+      v.count = count.load(std::memory_order_relaxed);
+      v.sampled = sampled.load(std::memory_order_relaxed);
+      v.ticks = ticks.load(std::memory_order_relaxed);
+      for(std::size_t i = 0; i < rusage_fields; ++i)
+        v.fields[i] = fields[i].load(std::memory_order_relaxed);
+      return v;
+    }
+
+    static void print(const DebugPrinter & d,
+                      site_table<rusage_slot>::rows rows) {
+      rows.erase(std::remove_if(rows.begin(), rows.end(),
+                   [](const auto & r) { return r.second.sampled == 0; }), rows.end());
+      if(rows.empty()) return;
+      std::stable_sort(rows.begin(), rows.end(), [](const auto & a, const auto & b) {
+        return a.second.ticks * b.second.sampled > b.second.ticks * a.second.sampled;
+      });
+      auto format = [](const double v) {
+        char buf[32];
+        std::snprintf(buf, sizeof buf, v >= 99.95 ? "%.0f" : "%.3g", v);
+        return std::string(buf);
+      };
+
+      std::ostream & out = *d.outstream;
+      out << d.hcol_ << "DebugPrinter resource usage per sampled call:"
+          << d.hcol_r_ << std::endl;
+      out << std::setw(10) << "count" << std::setw(10) << "sampled"
+          << std::setw(11) << "mean" << std::setw(11) << "user"
+          << std::setw(11) << "sys" << std::setw(9) << "minflt"
+          << std::setw(9) << "majflt" << std::setw(9) << "vcsw"
+          << std::setw(9) << "ivcsw" << std::setw(11) << "rss"
+          << std::setw(11) << "read" << std::setw(11) << "write"
+          << "  site" << std::endl;
+      const double scale = tick_clock::ns_per_tick();
+      for(const auto & r : rows) {
+        const value & v = r.second;
+        const double n = static_cast<double>(v.sampled);
+        auto mean = [&](const std::size_t i) { return static_cast<double>(v.fields[i]) / n; };
+        auto bytes = [&](const std::size_t i) {
+          return format_bytes(static_cast<std::int64_t>(
+            static_cast<double>(static_cast<std::int64_t>(v.fields[i])) / n));
+        };
+        out << std::setw(10) << v.count << std::setw(10) << v.sampled
+            << std::setw(11) << format_ns(scale * static_cast<double>(v.ticks) / n)
+            << std::setw(11) << format_ns(mean(ru_user))
+            << std::setw(11) << format_ns(mean(ru_sys))
+            << std::setw(9) << format(mean(ru_minflt))
+            << std::setw(9) << format(mean(ru_majflt))
+            << std::setw(9) << format(mean(ru_vcsw))
+            << std::setw(9) << format(mean(ru_ivcsw))
+            << std::setw(11) << bytes(ru_rss)
+            << std::setw(11) << bytes(ru_rchar)
+            << std::setw(11) << bytes(ru_wchar)
+            << "  " << r.first.label << " (" << r.first.file << ":"
+            << r.first.line << ")" << std::endl;
+      }
+    }
+  };
+
+  // Per-thread trip counts of one dout_TRIP site: exact below 32, then one
+  // bucket per power of two
+  struct trip_slot {
+    static constexpr std::size_t exact = 32, pow2 = 64;
+
+    struct value {
+      std::uint64_t count = 0, sum = 0, max = 0;
+      std::uint64_t small[exact] = {}, large[pow2] = {};
+      void merge(const value & o) noexcept {
+        count += o.count;
+        sum += o.sum;
+        max = std::max(max, o.max);
+        for(std::size_t i = 0; i < exact; ++i) small[i] += o.small[i];
+        for(std::size_t i = 0; i < pow2; ++i) large[i] += o.large[i];
+      }
+    };
+
+    std::atomic<std::uint64_t> count{0}, sum{0}, max{0};
+    std::atomic<std::uint64_t> small[exact], large[pow2];
+
+    trip_slot() noexcept {
+      for(auto & c : small) c.store(0, std::memory_order_relaxed);
+      for(auto & c : large) c.store(0, std::memory_order_relaxed);
+    }
+
+    void record(const std::uint64_t n) noexcept {
+      if(n < exact)
+        bump(small[n], std::uint64_t(1));
+      else
+        bump(large[63 - __builtin_clzll(n)], std::uint64_t(1));
+      bump(count, std::uint64_t(1));
+      bump(sum, n);
+      if(n > max.load(std::memory_order_relaxed))
+        max.store(n, std::memory_order_relaxed);
+    }
+
+    value load() const noexcept {
+      value v;
+      v.count = count.load(std::memory_order_relaxed);
+      v.sum = sum.load(std::memory_order_relaxed);
+      v.max = max.load(std::memory_order_relaxed);
+      for(std::size_t i = 0; i < exact; ++i)
+        v.small[i] = small[i].load(std::memory_order_relaxed);
+      for(std::size_t i = 0; i < pow2; ++i)
+        v.large[i] = large[i].load(std::memory_order_relaxed);
+      return v;
+    }
+
+    static void print(const DebugPrinter & d,
+                      const site_table<trip_slot>::rows & rows) {
+      bool header = false;
+      std::ostream & out = *d.outstream;
+      for(const auto & r : rows) {
+        const value & v = r.second;
+        if(v.count == 0) continue;
+        if(!header)
+          out << d.hcol_ << "DebugPrinter trip counts:" << d.hcol_r_ << std::endl;
+        header = true;
+        char mean[32];
+        std::snprintf(mean, sizeof mean, "%.4g",
+                      static_cast<double>(v.sum) / static_cast<double>(v.count));
+        out << "  " << r.first.label << " (" << r.first.file << ":"
+            << r.first.line << ")  n=" << v.count << "  mean=" << mean
+            << "  max=" << v.max << std::endl;
+
+        // (label, count) of the non-empty exact values and buckets
+        std::vector<std::pair<std::string, std::uint64_t>> bars;
+        for(std::size_t i = 0; i < exact; ++i)
+          if(v.small[i] != 0)
+            bars.emplace_back(std::to_string(i), v.small[i]);
+        for(std::size_t i = 0; i < pow2; ++i)
+          if(v.large[i] != 0)
+            bars.emplace_back(std::to_string(std::uint64_t(1) << i) + "-" +
+                              std::to_string((std::uint64_t(2) << i) - 1), v.large[i]);
+        std::uint64_t top = 0, cum = 0;
+        for(const auto & b : bars) top = std::max(top, b.second);
+        for(const auto & b : bars) {
+          cum += b.second;
+          const std::size_t bar = static_cast<std::size_t>(
+            40 * static_cast<double>(b.second) / static_cast<double>(top) + 0.5);
+          char pct[32];
+          std::snprintf(pct, sizeof pct, "%5.1f%% %5.1f%%",
+                        100. * static_cast<double>(b.second) / static_cast<double>(v.count),
+                        100. * static_cast<double>(cum) / static_cast<double>(v.count));
+          out << std::setw(14) << b.first << " |" << std::string(bar, '#')
+              << std::string(40 - bar, ' ') << " " << pct << "  " << b.second
+              << std::endl;
+        }
+      }
+    }
+  };
+
+  // Per-thread outcomes of one dout_BRANCH site
+  struct branch_slot {
+    struct value {
+      std::uint64_t taken = 0, not_taken = 0;
+      void merge(const value & o) noexcept {
+        taken += o.taken;
+        not_taken += o.not_taken;
+      }
+    };
+
+    std::atomic<std::uint64_t> taken{0}, not_taken{0};
+
+    value load() const noexcept {
+      value v;
+      v.taken = taken.load(std::memory_order_relaxed);
+      v.not_taken = not_taken.load(std::memory_order_relaxed);
+      return v;
+    }
+
+    static void print(const DebugPrinter & d,
+                      site_table<branch_slot>::rows rows) {
+      auto hits = [](const value & v) { return v.taken + v.not_taken; };
+      rows.erase(std::remove_if(rows.begin(), rows.end(),
+                   [&](const auto & r) { return hits(r.second) == 0; }), rows.end());
+      if(rows.empty()) return;
+      std::stable_sort(rows.begin(), rows.end(), [&](const auto & a, const auto & b) {
+        return hits(a.second) > hits(b.second);
+      });
+      std::ostream & out = *d.outstream;
+      out << d.hcol_ << "DebugPrinter branches:" << d.hcol_r_ << std::endl;
+      out << std::setw(14) << "hits" << std::setw(14) << "true"
+          << std::setw(9) << "true%" << std::setw(10) << "hint" << "  site" << std::endl;
+      for(const auto & r : rows) {
+        const value & v = r.second;
+        const double ratio = static_cast<double>(v.taken)
+                           / static_cast<double>(hits(v));
+        char pct[16];
+        std::snprintf(pct, sizeof pct, "%.1f%%", 100 * ratio);
+        out << std::setw(14) << hits(v) << std::setw(14) << v.taken
+            << std::setw(9) << pct << std::setw(10)
+            << (ratio >= 0.9 ? "likely" : ratio <= 0.1 ? "unlikely" : "")
+            << "  " << r.first.label << " (" << r.first.file << ":"
+            << r.first.line << ")" << std::endl;
+      }
+    }
+  };
+
+  // Per-thread running statistics of one dout_STAT site (Welford), merged
+  // with the pairwise update of Chan et al.
+  struct stat_slot {
+    struct value {
+      std::uint64_t count = 0, stamp = 0;        // stamp: tick of last, 0: none
+      double mean = 0, m2 = 0, last = 0;
+      double min = std::numeric_limits<double>::infinity();
+      double max = -std::numeric_limits<double>::infinity();
+      void merge(const value & o) noexcept {
+        if(o.count == 0) return;
+        const double n = static_cast<double>(count + o.count);
+        const double delta = o.mean - mean;
+        mean += delta * static_cast<double>(o.count) / n;
+        m2 += o.m2 + delta * delta * static_cast<double>(count)
+                                   * static_cast<double>(o.count) / n;
+        count += o.count;
+        min = std::min(min, o.min);
+        max = std::max(max, o.max);
+        if(o.stamp > stamp) {
+          stamp = o.stamp;
+          last = o.last;
+        }
+      }
+    };
+
+    std::atomic<std::uint64_t> count{0}, stamp{0};
+    std::atomic<double> mean{0}, m2{0}, last{0};
+    std::atomic<double> min{std::numeric_limits<double>::infinity()};
+    std::atomic<double> max{-std::numeric_limits<double>::infinity()};
+
+    void record(const double v) noexcept {
+      const std::uint64_t n = count.load(std::memory_order_relaxed) + 1;
+      const double m = mean.load(std::memory_order_relaxed);
+      const double delta = v - m;
+      const double m_new = m + delta / static_cast<double>(n);
+      bump(m2, delta * (v - m_new));
+      mean.store(m_new, std::memory_order_relaxed);
+      count.store(n, std::memory_order_relaxed);
+      if(v < min.load(std::memory_order_relaxed))
+        min.store(v, std::memory_order_relaxed);
+      if(v > max.load(std::memory_order_relaxed))
+        max.store(v, std::memory_order_relaxed);
+    }
+
+    void record_last(const double v) noexcept {
+      record(v);
+      last.store(v, std::memory_order_relaxed);
+      stamp.store(tick_clock::now(), std::memory_order_relaxed);
+    }
+
+    value load() const noexcept {
+      value v;
+      v.count = count.load(std::memory_order_relaxed);
+      v.stamp = stamp.load(std::memory_order_relaxed);
+      v.mean = mean.load(std::memory_order_relaxed);
+      v.m2 = m2.load(std::memory_order_relaxed);
+      v.last = last.load(std::memory_order_relaxed);
+      v.min = min.load(std::memory_order_relaxed);
+      v.max = max.load(std::memory_order_relaxed);
+      return v;
+    }
+
+    static void print(const DebugPrinter & d,
+                      site_table<stat_slot>::rows rows) {
+      rows.erase(std::remove_if(rows.begin(), rows.end(),
+                   [](const auto & r) { return r.second.count == 0; }), rows.end());
+      if(rows.empty()) return;
+      bool last = false;
+      for(const auto & r : rows) last |= r.second.stamp != 0;
+
+      std::ostream & out = *d.outstream;
+      const std::streamsize prec = out.precision(d.prec_);
+      out << d.hcol_ << "DebugPrinter statistics:" << d.hcol_r_ << std::endl;
+      out << std::setw(10) << "count" << std::setw(14) << "mean"
+          << std::setw(14) << "stddev" << std::setw(14) << "min"
+          << std::setw(14) << "max";
+      if(last) out << std::setw(14) << "last";
+      out << "  site" << std::endl;
+      for(const auto & r : rows) {
+        const value & v = r.second;
+        const double var = v.count > 1 ? v.m2 / static_cast<double>(v.count - 1) : 0;
+        out << std::setw(10) << v.count << std::setw(14) << v.mean
+            << std::setw(14) << std::sqrt(var) << std::setw(14) << v.min
+            << std::setw(14) << v.max;
+        if(last) {
+          out << std::setw(14);
+          if(v.stamp != 0) out << v.last; else out << "-";
+        }
+        out << "  " << r.first.label << " (" << r.first.file << ":"
+            << r.first.line << ")" << std::endl;
+      }
+      out.precision(prec);
+    }
+  };
+
+  // Rates with 3 significant digits and SI prefix, e.g. "12.3 GB/s", "450 M/s"
+  static std::string format_rate(double per_s, const char * unit) {
+    static const char * const prefix[] = {"", "k", "M", "G", "T"};
+    std::size_t p = 0;
+    for(; p < 4 && per_s >= 999.5; ++p) per_s /= 1000;
+    char buf[32];
+    std::snprintf(buf, sizeof buf, per_s >= 99.95 ? "%.0f %s%s/s" : per_s >= 9.995
+                  ? "%.1f %s%s/s" : "%.2f %s%s/s", per_s, prefix[p], unit);
+    return buf;
+  }
+
+  // Per-thread sums of one dout_THROUGHPUT site
+  struct throughput_slot {
+    struct value {
+      std::uint64_t count = 0, ticks = 0, bytes = 0, items = 0;
+      void merge(const value & o) noexcept {
+        count += o.count;
+        ticks += o.ticks;
+        bytes += o.bytes;
+        items += o.items;
+      }
+    };
+
+    std::atomic<std::uint64_t> count{0}, ticks{0}, bytes{0}, items{0};
+
+    void record(const std::uint64_t t, const std::uint64_t b,
+                const std::uint64_t i) noexcept {
+      bump(count, std::uint64_t(1));
+      bump(ticks, t);
+      bump(bytes, b);
+      bump(items, i);
+    }
+
+    value load() const noexcept {
+      value v;
+      v.count = count.load(std::memory_order_relaxed);
+      v.ticks = ticks.load(std::memory_order_relaxed);
+      v.bytes = bytes.load(std::memory_order_relaxed);
+      v.items = items.load(std::memory_order_relaxed);
+      return v;
+    }
+
+    static void print(const DebugPrinter & d,
+                      site_table<throughput_slot>::rows rows) {
+      rows.erase(std::remove_if(rows.begin(), rows.end(),
+                   [](const auto & r) { return r.second.count == 0; }), rows.end());
+      if(rows.empty()) return;
+      std::stable_sort(rows.begin(), rows.end(), [](const auto & a, const auto & b) {
+        return a.second.ticks > b.second.ticks;
+      });
+      const double scale = tick_clock::ns_per_tick();
+      const bool peak = d.peak_gbs_ > 0;
+
+      std::ostream & out = *d.outstream;
+      out << d.hcol_ << "DebugPrinter throughput:" << d.hcol_r_ << std::endl;
+      out << std::setw(10) << "count" << std::setw(11) << "total"
+          << std::setw(11) << "mean" << std::setw(11) << "bytes"
+          << std::setw(12) << "bandwidth";
+      if(peak) out << std::setw(7) << "peak";
+      out << std::setw(12) << "items" << "  site" << std::endl;
+      for(const auto & r : rows) {
+        const value & v = r.second;
+        const double ns = scale * static_cast<double>(v.ticks);
+        const double gbs = ns > 0 ? static_cast<double>(v.bytes) / ns : 0;
+        out << std::setw(10) << v.count << std::setw(11) << format_ns(ns)
+            << std::setw(11) << format_ns(ns / static_cast<double>(v.count))
+            << std::setw(11) << format_bytes(static_cast<std::int64_t>(v.bytes))
+            << std::setw(12) << (v.bytes == 0 ? "-" : format_rate(1e9 * gbs, "B"));
+        if(peak) {
+          char pct[16];
+          std::snprintf(pct, sizeof pct, "%.0f%%", 100 * gbs / d.peak_gbs_);
+          out << std::setw(7) << (v.bytes == 0 ? "-" : pct);
+        }
+        out << std::setw(12) << (v.items == 0 || ns == 0 ? "-"
+                                 : format_rate(1e9 * static_cast<double>(v.items) / ns, ""))
+            << "  " << r.first.label << " (" << r.first.file << ":"
+            << r.first.line << ")" << std::endl;
+      }
+    }
+  };
+
+  // Call tree merged over threads, node 0 is the root, children by site
+  struct call_node {
+    explicit call_node(const std::uint32_t s) : site(s) {}
+    std::uint32_t site;
+    std::uint64_t count = 0, ticks = 0, child_ticks = 0;
+    std::map<std::uint32_t, std::size_t> children;
+  };
+  using call_tree = std::vector<call_node>;
+
+  // Report of dout_SCOPE and DEBUGPRINTER_INSTRUMENT, site(id) gives the
+  // site_info
+  template <typename Site>
+  static void print_call_tree(const DebugPrinter & d, const char * title,
+                              const char * what, const call_tree & m,
+                              const Site & site) {
+    double total = 0;
+    for(const auto & c : m[0].children)
+      total += static_cast<double>(m[c.second].ticks);
+    std::ostream & out = *d.outstream;
+    out << d.hcol_ << title << d.hcol_r_ << std::endl;
+    out << std::setw(8) << "incl" << std::setw(8) << "excl"
+        << std::setw(10) << "count" << std::setw(11) << "incl"
+        << std::setw(11) << "excl" << "  " << what << std::endl;
+    print_calls(out, m, 0, 0, total, tick_clock::ns_per_tick(), site);
+  }
+
+  // Children by inclusive time, indented by depth
+  template <typename Site>
+  static void print_calls(std::ostream & out, const call_tree & m, const std::size_t mi,
+                          const int depth, const double total, const double scale,
+                          const Site & site) {
+    std::vector<std::size_t> children;
+    for(const auto & c : m[mi].children)
+      children.push_back(c.second);
+    std::stable_sort(children.begin(), children.end(),
+      [&m](std::size_t a, std::size_t b) { return m[a].ticks > m[b].ticks; });
+    for(const std::size_t c : children) {
+      const call_node & n = m[c];
+      const double incl = static_cast<double>(n.ticks);
+      const double excl = static_cast<double>(n.ticks - std::min(n.ticks, n.child_ticks));
+      char pct[2][16];
+      std::snprintf(pct[0], sizeof pct[0], "%.1f%%", total > 0 ? 100 * incl / total : 0.);
+      std::snprintf(pct[1], sizeof pct[1], "%.1f%%", total > 0 ? 100 * excl / total : 0.);
+      const site_info & s = site(n.site);
+      out << std::setw(8) << pct[0] << std::setw(8) << pct[1]
+          << std::setw(10) << n.count
+          << std::setw(11) << format_ns(scale * incl)
+          << std::setw(11) << format_ns(scale * excl) << "  "
+          << std::string(2 * static_cast<std::size_t>(depth), ' ')
+          << s.label << " (" << s.file;
+      if(s.line != 0) out << ":" << s.line;
+      out << ")" << std::endl;
+      print_calls(out, m, c, depth + 1, total, scale, site);
+    }
+  }
+
+  // dout_SCOPE call tree. Each thread grows its own tree of (parent, site)
+  // nodes (chunked and linked through atomics, so that report() can walk it
+  // meanwhile) and keeps a stack of open scopes. Trees are merged by path at
+  // report time and into the retired tree when their thread exits.
+  class scope_tree {
+    public:
+      static scope_tree & instance() {
+        static scope_tree * tree = new scope_tree;   // never destroyed
+        return *tree;
+      }
+
+      std::uint32_t add(const DebugPrinter & d, const std::string & label,
+                        const char * file, const int line) {
+        profile_registry & reg = profiling();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        if(reg.exit_printer == nullptr)
+          reg.exit_printer = &d;
+        sites_.push_back({label, d.detail_.filemacro_name(file), line});
+        return static_cast<std::uint32_t>(sites_.size() - 1);
+      }
+
+      // Open a scope of the calling thread, returns its thread_tree
+      void * enter(const std::uint32_t site) {
+        thread_local owner own;
+        if(own.t == nullptr)
+          own.t = attach();
+        thread_tree & t = *own.t;
+        const std::uint32_t parent = t.stack.empty() ? 0 : t.stack.back().node;
+        node & p = t.at(parent);
+        std::uint32_t c = p.first_child.load(std::memory_order_relaxed);
+        while(c != none && t.at(c).site != site)
+          c = t.at(c).next_sibling.load(std::memory_order_relaxed);
+        if(c == none)
+          c = t.append(site, parent);
+        t.stack.push_back({c, tick_clock::now()});
+        return own.t;
+      }
+
+      static void leave(void * tree) noexcept {
+        const std::uint64_t stop = tick_clock::now();
+        thread_tree & t = *static_cast<thread_tree *>(tree);
+        const frame f = t.stack.back();
+        t.stack.pop_back();
+        const std::uint64_t d = tick_clock::elapsed(f.start, stop);
+        node & n = t.at(f.node);
+        bump(n.count, std::uint64_t(1));
+        bump(n.ticks, d);
+        bump(t.at(n.parent).child_ticks, d);
+      }
+
+    private:
+      static constexpr std::uint32_t none = 0xffffffffu;
+      static constexpr std::size_t chunk = 256, max_chunks = 4096;
+
+      struct node {
+        std::uint32_t site, parent;
+        std::atomic<std::uint32_t> first_child{none}, next_sibling{none};
+        std::atomic<std::uint64_t> count{0}, ticks{0}, child_ticks{0};
+      };
+      struct frame {
+        std::uint32_t node;
+        std::uint64_t start;
+      };
+
+      struct thread_tree {
+        std::atomic<node *> chunks[max_chunks];
+        std::atomic<std::uint32_t> size{0};      // published nodes
+        std::vector<frame> stack;                // owner only
+
+        thread_tree() {
+          for(auto & c : chunks) c.store(nullptr, std::memory_order_relaxed);
+          stack.reserve(64);
+          append(none, 0);                       // root
+        }
+        ~thread_tree() {
+          for(auto & c : chunks) delete[] c.load(std::memory_order_relaxed);
+        }
+        node & at(const std::uint32_t i) const noexcept {
+          return chunks[i / chunk].load(std::memory_order_acquire)[i % chunk];
+        }
+        std::uint32_t append(const std::uint32_t site, const std::uint32_t parent) {
+          const std::uint32_t i = size.load(std::memory_order_relaxed);
+          if(i == chunk * max_chunks)
+            throw std::runtime_error("DebugPrinter error: scope tree too large");
+          if(i % chunk == 0)
+            chunks[i / chunk].store(new node[chunk], std::memory_order_release);
+          node & n = at(i);
+          n.site = site;
+          n.parent = parent;
+          size.store(i + 1, std::memory_order_release);
+          if(site != none) {                     // link as first child
+            node & p = at(parent);
+            n.next_sibling.store(p.first_child.load(std::memory_order_relaxed),
+                                 std::memory_order_relaxed);
+            p.first_child.store(i, std::memory_order_release);
+          }
+          return i;
+        }
+      };
+      struct owner {                             // thread_local, retires tree
+        thread_tree * t = nullptr;
+        ~owner() { if(t != nullptr) instance().retire(t); }
+      };
+
+      using merged = call_tree;
+
+      scope_tree() : retired_(1, call_node(none)) {
+        profile_registry & reg = profiling();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.reporters.push_back(&report);
+      }
+
+      thread_tree * attach() {
+        thread_tree * t = new thread_tree;
+        std::lock_guard<std::mutex> lock(profiling().mutex);
+        trees_.push_back(t);
+        return t;
+      }
+
+      void retire(thread_tree * t) {
+        {
+          std::lock_guard<std::mutex> lock(profiling().mutex);
+          merge(retired_, 0, *t, 0);
+          trees_.erase(std::find(trees_.begin(), trees_.end(), t));
+        }
+        delete t;
+      }
+
+      static void merge(merged & m, const std::size_t mi,
+                        const thread_tree & t, const std::uint32_t ti) {
+        const node & n = t.at(ti);
+        m[mi].count += n.count.load(std::memory_order_relaxed);
+        m[mi].ticks += n.ticks.load(std::memory_order_relaxed);
+        m[mi].child_ticks += n.child_ticks.load(std::memory_order_relaxed);
+        for(std::uint32_t c = n.first_child.load(std::memory_order_acquire);
+            c != none; c = t.at(c).next_sibling.load(std::memory_order_acquire)) {
+          const std::uint32_t site = t.at(c).site;
+          auto it = m[mi].children.find(site);
+          if(it == m[mi].children.end()) {
+            it = m[mi].children.emplace(site, m.size()).first;
+            m.push_back(call_node(site));
+          }
+          merge(m, it->second, t, c);
+        }
+      }
+
+      static void report(const DebugPrinter & d) {
+        scope_tree & self = instance();
+        std::lock_guard<std::mutex> lock(profiling().mutex);
+        merged m = self.retired_;
+        for(const thread_tree * t : self.trees_)
+          merge(m, 0, *t, 0);
+        if(m[0].children.empty())
+          return;
+        print_call_tree(d, "DebugPrinter scopes:", "scope", m,
+          [&self](std::uint32_t s) -> const site_info & { return self.sites_[s]; });
+      }
+
+      std::deque<site_info> sites_;
+      merged retired_;
+      std::vector<thread_tree *> trees_;
+  };
+
+  // DEBUGPRINTER_INSTRUMENT. The hooks may run while this header holds its
+  // locks, so every thread logs (function, tick) pairs into its own block
+  // without locking or symbolizing anything, and pushes its log onto a
+  // lock-free list. Full blocks are folded into the thread's call tree by
+  // address, or kept for the timeline while tracing. report() and
+  // trace_stop() resolve the addresses and apply set_instrument_filter().
+  struct instrument_event {
+    std::uint64_t tick;
+    const void * fn;                             // nullptr on return
+  };
+
+  struct instrument_log {
+    static constexpr std::size_t block_size = 4096;
+    static constexpr std::size_t max_kept = 1024;         // 4M calls per trace
+    static constexpr std::uint32_t none = 0xffffffffu;
+    struct node {
+      const void * fn;
+      std::uint32_t parent, first_child, next_sibling;
+      std::uint64_t count, ticks;
+    };
+    struct frame {
+      std::uint32_t node;
+      std::uint64_t start;
+    };
+
+    std::mutex mutex;                            // all but owner-only fields
+    instrument_event * block = new instrument_event[block_size];
+    std::atomic<std::size_t> size{0};            // published events of block
+    std::vector<node> tree{{nullptr, none, none, none, 0, 0}};
+    std::vector<frame> stack;
+    std::vector<instrument_event *> kept;        // full blocks of the trace
+    std::size_t begin = 0;                       // first event of the trace
+    std::size_t dropped = 0;                     // events beyond max_kept
+    bool keep = false;
+    const std::uint32_t tid = trace_tid();
+    instrument_log * next = nullptr;
+
+    // Owner only
+    void append(const void * fn) {
+      const std::size_t n = size.load(std::memory_order_relaxed);
+      block[n] = {tick_clock::now(), fn};
+      size.store(n + 1, std::memory_order_release);
+      if(n + 1 == block_size)
+        flush();
+    }
+    void flush() {
+      std::lock_guard<std::mutex> lock(mutex);
+      const std::size_t n = size.load(std::memory_order_relaxed);
+      fold(tree, stack, block, n);
+      if(keep && kept.size() < max_kept) {
+        kept.push_back(block);
+        block = new instrument_event[block_size];
+      } else if(keep) {
+        dropped += n;
+      }
+      size.store(0, std::memory_order_release);
+    }
+    void retire() {                              // at thread exit
+      flush();
+      std::lock_guard<std::mutex> lock(mutex);
+      delete[] block;
+      block = nullptr;
+    }
+
+    // Replay events onto a tree, open calls stay on the stack
+    static void fold(std::vector<node> & tree, std::vector<frame> & stack,
+                     const instrument_event * e, const std::size_t n) {
+      for(std::size_t i = 0; i < n; ++i) {
+        if(e[i].fn != nullptr) {
+          const std::uint32_t parent = stack.empty() ? 0 : stack.back().node;
+          std::uint32_t c = tree[parent].first_child;
+          while(c != none && tree[c].fn != e[i].fn)
+            c = tree[c].next_sibling;
+          if(c == none) {
+            c = static_cast<std::uint32_t>(tree.size());
+            tree.push_back({e[i].fn, parent, none, tree[parent].first_child, 0, 0});
+            tree[parent].first_child = c;
+          }
+          stack.push_back({c, e[i].tick});
+        } else if(!stack.empty()) {
+          node & f = tree[stack.back().node];
+          ++f.count;
+          f.ticks += e[i].tick - stack.back().start;   // overhead off in merge
+          stack.pop_back();
+        }
+      }
+    }
+  };
+
+  struct instrument_fn {
+    site_info site;                              // label, module, line 0
+    std::string json, key;                       // trace name, filter subject
+    bool on;
+  };
+
+  struct instrument_registry {
+    std::mutex mutex;
+    std::map<const void *, std::uint32_t> ids;
+    std::vector<instrument_fn> fns;
+    std::vector<std::string> include, exclude;
+
+    bool match(const std::string & key) const {
+      auto any = [&key](const std::vector<std::string> & patterns) {
+        for(const std::string & p : patterns)
+          if(key.find(p) != std::string::npos) return true;
+        return false;
+      };
+      return (include.empty() || any(include)) && !any(exclude);
+    }
+
+    // Symbolized on first use
+    std::uint32_t resolve(const void * fn) {
+      auto it = ids.find(fn);
+      if(it != ids.end())
+        return it->second;
+      char addr[32];
+      std::snprintf(addr, sizeof addr, "%p", fn);
+      std::string label = addr, module;
+      #ifndef DEBUGPRINTER_NO_EXECINFO
+      void * const p = const_cast<void *>(fn);
+      if(char ** symbols = backtrace_symbols(&p, 1)) {
+        const std::string line = symbols[0];
+        std::free(symbols);
+        module = prog_part(line);
+        const std::string mangled = mangled_part(line);
+        int status = 0;
+        if(!mangled.empty())
+          label = demangle(mangled, status);
+      }
+      #endif // DEBUGPRINTER_NO_EXECINFO
+      const std::uint32_t id = static_cast<std::uint32_t>(fns.size());
+      fns.emplace_back();
+      instrument_fn & f = fns.back();
+      f.site.label = label;
+      f.site.file = module.substr(module.rfind(DEBUGPRINTER_DIRSEP) + 1);
+      f.site.line = 0;
+      f.json = json_escape(label);
+      f.key = label + " " + module;
+      f.on = match(f.key);
+      ids.emplace(fn, id);
+      return id;
+    }
+
+    // Filtered calls of a thread tree, excluded calls pass their callees up
+    void merge(call_tree & m, const std::size_t mi,
+               const std::vector<instrument_log::node> & t, const std::uint32_t ti) {
+      for(std::uint32_t c = t[ti].first_child; c != instrument_log::none;
+          c = t[c].next_sibling) {
+        const std::uint32_t id = resolve(t[c].fn);
+        std::size_t to = mi;
+        if(fns[id].on) {
+          auto it = m[mi].children.find(id);
+          if(it == m[mi].children.end()) {
+            it = m[mi].children.emplace(id, m.size()).first;
+            m.push_back(call_node(id));
+          }
+          to = it->second;
+          const std::uint64_t ticks =
+            t[c].ticks - std::min(t[c].ticks, t[c].count * tick_clock::overhead());
+          m[to].count += t[c].count;
+          m[to].ticks += ticks;
+          m[mi].child_ticks += ticks;
+        }
+        merge(m, to, t, c);
+      }
+    }
+  };
+
+  static instrument_registry & instrumenting() {
+    static instrument_registry * reg = new instrument_registry;  // never destroyed
+    return *reg;
+  }
+
+  // Constant-initialized, safe in the hooks. These must not reach a local
+  // static under construction (the clock calibration runs instrumented
+  // code), hence nothing is recorded before instrument_register().
+  static std::atomic<instrument_log *> & instrument_logs() noexcept {
+    static std::atomic<instrument_log *> head{nullptr};
+    return head;
+  }
+
+  static std::atomic<bool> & instrument_ready() noexcept {
+    static std::atomic<bool> ready{false};
+    return ready;
+  }
+
+  static std::atomic<bool> & instrument_on() noexcept {
+    static std::atomic<bool> on{true};
+    return on;
+  }
+
+  struct instrument_thread {                     // trivial, thread_local
+    static constexpr std::size_t max_depth = 4096;
+    std::uint64_t logged[max_depth / 64];        // calls to log the return of
+    std::size_t depth;
+    instrument_log * log;
+    bool busy, retired;
+  };
+
+  DEBUGPRINTER_NO_INSTRUMENT
+  static instrument_thread & instrument_local() noexcept {
+    thread_local instrument_thread t;
+    return t;
+  }
+
+  // Hooks of the calling thread off while this header holds a log
+  struct instrument_pause {
+    instrument_pause() noexcept : was(instrument_local().busy) {
+      instrument_local().busy = true;
+    }
+    ~instrument_pause() { instrument_local().busy = was; }
+    instrument_pause(const instrument_pause &) = delete;
+    instrument_pause & operator=(const instrument_pause &) = delete;
+    const bool was;
+  };
+
+  static instrument_log * instrument_attach() {
+    struct owner {
+      instrument_log * log = nullptr;
+      ~owner() {
+        if(log == nullptr) return;
+        instrument_thread & t = instrument_local();
+        t.busy = true;
+        log->retire();
+        t.log = nullptr;
+        t.retired = true;
+        t.busy = false;
+      }
+    };
+    thread_local owner own;
+    own.log = new instrument_log;
+    std::atomic<instrument_log *> & head = instrument_logs();
+    own.log->next = head.load(std::memory_order_relaxed);
+    while(!head.compare_exchange_weak(own.log->next, own.log,
+                                      std::memory_order_release,
+                                      std::memory_order_relaxed)) {}
+    return own.log;
+  }
+
+  DEBUGPRINTER_NO_INSTRUMENT
+  static void instrument_enter(const void * fn) noexcept {
+    instrument_thread & t = instrument_local();
+    if(t.busy) return;
+    t.busy = true;                               // even atomics may be hooked
+    const std::size_t depth = t.depth++;
+    if(depth < instrument_thread::max_depth) {
+      std::uint64_t & word = t.logged[depth / 64];
+      const std::uint64_t bit = std::uint64_t(1) << (depth % 64);
+      word &= ~bit;
+      if(!t.retired && instrument_ready().load(std::memory_order_acquire)
+         && instrument_on().load(std::memory_order_relaxed)) {
+        if(t.log == nullptr)
+          t.log = instrument_attach();
+        t.log->append(fn);
+        word |= bit;
+      }
+    }
+    t.busy = false;
+  }
+
+  DEBUGPRINTER_NO_INSTRUMENT
+  static void instrument_exit() noexcept {
+    instrument_thread & t = instrument_local();
+    if(t.busy || t.depth == 0) return;
+    t.busy = true;
+    const std::size_t depth = --t.depth;
+    if(depth < instrument_thread::max_depth && t.log != nullptr
+       && (t.logged[depth / 64] & (std::uint64_t(1) << (depth % 64))))
+      t.log->append(nullptr);
+    t.busy = false;
+  }
+
+  static bool instrument_register(const DebugPrinter & d) {
+    tick_clock::overhead();                      // calibrate before first use
+    instrumenting();
+    {
+      profile_registry & reg = profiling();        // report() at exit
+      std::lock_guard<std::mutex> lock(reg.mutex);
+      if(reg.exit_printer == nullptr)
+        reg.exit_printer = &d;
+    }
+    instrument_ready().store(true, std::memory_order_release);
+    return true;
+  }
+
+  static void instrument_report(const DebugPrinter & d) {
+    instrument_pause pause;
+    instrument_registry & reg = instrumenting();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    call_tree m(1, call_node(instrument_log::none));
+    for(instrument_log * l = instrument_logs().load(std::memory_order_acquire);
+        l != nullptr; l = l->next) {
+      std::vector<instrument_log::node> tree;
+      {
+        std::lock_guard<std::mutex> llock(l->mutex);
+        tree = l->tree;
+        std::vector<instrument_log::frame> stack = l->stack;
+        if(l->block != nullptr)
+          instrument_log::fold(tree, stack, l->block,
+                               l->size.load(std::memory_order_acquire));
+        const std::uint64_t now = tick_clock::now();
+        for(const instrument_log::frame & f : stack)   // open calls so far
+          tree[f.node].ticks += now - f.start;
+      }
+      reg.merge(m, 0, tree, 0);
+    }
+    if(m[0].children.empty())
+      return;
+    print_call_tree(d, "DebugPrinter instrumented functions:", "function", m,
+      [&reg](std::uint32_t s) -> const site_info & { return reg.fns[s].site; });
+  }
+
+  // trace_start() keeps the full blocks from now on, trace_stop() drops them
+  static void instrument_trace(const bool start) {
+    instrument_pause pause;
+    for(instrument_log * l = instrument_logs().load(std::memory_order_acquire);
+        l != nullptr; l = l->next) {
+      std::lock_guard<std::mutex> lock(l->mutex);
+      for(instrument_event * b : l->kept)
+        delete[] b;
+      l->kept.clear();
+      l->dropped = 0;
+      l->keep = start;
+      l->begin = l->block == nullptr ? 0 : l->size.load(std::memory_order_acquire);
+    }
+  }
+
+  // B and E events of the filtered calls, on the track of the thread
+  static void instrument_write(std::FILE * f, const trace_registry & tr,
+                               const char *& sep, std::size_t & events,
+                               std::size_t & dropped) {
+    instrument_pause pause;
+    instrument_registry & reg = instrumenting();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    const double us = tick_clock::ns_per_tick() / 1000;
+    for(instrument_log * l = instrument_logs().load(std::memory_order_acquire);
+        l != nullptr; l = l->next) {
+      std::lock_guard<std::mutex> llock(l->mutex);
+      if(!l->keep) continue;
+      std::vector<std::pair<const instrument_event *, std::size_t>> parts;
+      for(const instrument_event * b : l->kept)
+        parts.emplace_back(b, std::size_t(instrument_log::block_size));
+      const std::size_t size = l->block == nullptr ? 0
+                             : l->size.load(std::memory_order_acquire);
+      if(l->dropped == 0)
+        parts.emplace_back(l->block, size);
+      else                                       // after the gap
+        dropped += l->dropped + size;
+      const std::uint32_t tid = l->tid;
+      std::vector<bool> open;                    // written B of open calls
+      std::size_t skip = l->begin;
+      bool named = false;
+      for(const auto & part : parts)
+        for(std::size_t i = 0; i < part.second; ++i) {
+          if(skip > 0) {
+            --skip;
+            continue;
+          }
+          const instrument_event & e = part.first[i];
+          std::uint32_t id = 0;
+          if(e.fn != nullptr) {
+            id = reg.resolve(e.fn);
+            open.push_back(reg.fns[id].on);
+            if(!open.back()) continue;
+          } else {
+            if(open.empty()) continue;           // called before the trace
+            const bool on = open.back();
+            open.pop_back();
+            if(!on) continue;
+          }
+          if(!named) {
+            std::fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                         "\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+                         sep, tid, tid);
+            sep = ",\n";
+            named = true;
+          }
+          const double ts = e.tick > tr.start ? us * static_cast<double>(e.tick - tr.start) : 0;
+          std::fprintf(f, ",\n{\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u",
+                       e.fn != nullptr ? 'B' : 'E', ts, tid);
+          if(e.fn != nullptr)
+            std::fprintf(f, ",\"name\":\"%s\"", reg.fns[id].json.c_str());
+          std::fputc('}', f);
+          ++events;
+        }
+    }
+  }
+
+  // dout_HIST buckets: log-linear, 32 per power of two (relative error
+  // < 3%, exact for integers < 64) over magnitudes [2^-16, 2^48), indexed
+  // directly by the exponent and top mantissa bits of the double. Negative
+  // values mirror the positive ones below the middle bucket, which holds
+  // magnitudes below 2^-16 and NaN as 0, so that the index grows with the
+  // value.
+  struct hist_buckets {
+    static constexpr int sub_bits = 5;
+    static constexpr std::size_t per = std::size_t(1) << sub_bits;
+    static constexpr std::size_t half = 64 * per;          // per sign
+    static constexpr std::size_t zero = half - 1;
+    static constexpr std::size_t size = 2 * half - 1;
+    static constexpr std::size_t bars = 2 * 64;           // powers of two
+    static constexpr std::uint64_t first = std::uint64_t(1023 - 16) << sub_bits;
+
+    static std::size_t magnitude(const double a) noexcept {
+      if(!(a > 0)) return 0;                     // also NaN
+      std::uint64_t bits;
+      std::memcpy(&bits, &a, sizeof bits);
+      const std::uint64_t i = bits >> (52 - sub_bits);
+      return i < first ? 0 : static_cast<std::size_t>(
+        std::min<std::uint64_t>(i - first, half - 1));
+    }
+    static double magnitude_lower(const std::size_t m) noexcept {
+      const std::uint64_t bits = (m + first) << (52 - sub_bits);
+      double v;
+      std::memcpy(&v, &bits, sizeof v);
+      return v;
+    }
+
+    static std::size_t index(const double v) noexcept {
+      return v < 0 ? zero - magnitude(-v) : zero + magnitude(v);
+    }
+    // Edge of bucket i closest to zero (exact for integers below 64)
+    static double value(const std::size_t i) noexcept {
+      return i >= zero ? (i == zero ? 0 : magnitude_lower(i - zero))
+                       : -magnitude_lower(zero - i);
+    }
+
+    // Power of two of bucket i, and the lowest value of one
+    static std::size_t bar(const std::size_t i) noexcept {
+      return i >= zero ? bars / 2 + (i - zero) / per
+                       : bars / 2 - 1 - (zero - i) / per;
+    }
+    static double bar_lower(const std::size_t b) noexcept {
+      if(b == bars / 2) return 0;                // holds the middle bucket
+      return b > bars / 2 ? magnitude_lower((b - bars / 2) * per)
+                          : -magnitude_lower((bars / 2 - b) * per);
+    }
+  };
+
+  // Per-thread histogram of one dout_HIST site, buckets allocated on first use
+  template <bool Time>
+  struct hist_slot {
+    using counter = std::atomic<std::uint64_t>;
+
+    struct value {
+      std::uint64_t count = 0;
+      double sum = 0;
+      double min = std::numeric_limits<double>::infinity();
+      double max = -std::numeric_limits<double>::infinity();
+      std::vector<std::uint64_t> buckets;
+      void merge(const value & o) {
+        count += o.count;
+        sum += o.sum;
+        min = std::min(min, o.min);
+        max = std::max(max, o.max);
+        if(o.buckets.empty()) return;
+        buckets.resize(hist_buckets::size);
+        for(std::size_t i = 0; i < hist_buckets::size; ++i)
+          buckets[i] += o.buckets[i];
+      }
+    };
+
+    counter count{0};
+    std::atomic<double> sum{0};
+    std::atomic<double> min{std::numeric_limits<double>::infinity()};
+    std::atomic<double> max{-std::numeric_limits<double>::infinity()};
+    std::atomic<counter *> buckets{nullptr};
+
+    hist_slot() = default;
+    hist_slot(const hist_slot &) = delete;
+    hist_slot & operator=(const hist_slot &) = delete;
+    ~hist_slot() { delete[] buckets.load(std::memory_order_relaxed); }
+
+    void record(const double v) {
+      counter * b = buckets.load(std::memory_order_relaxed);
+      if(b == nullptr) {
+        b = new counter[hist_buckets::size]();
+        buckets.store(b, std::memory_order_release);
+      }
+      bump(b[hist_buckets::index(v)], std::uint64_t(1));
+      bump(count, std::uint64_t(1));
+      bump(sum, v);
+      if(v < min.load(std::memory_order_relaxed))
+        min.store(v, std::memory_order_relaxed);
+      if(v > max.load(std::memory_order_relaxed))
+        max.store(v, std::memory_order_relaxed);
+    }
+
+    value load() const {
+      value v;
+      v.count = count.load(std::memory_order_relaxed);
+      v.sum = sum.load(std::memory_order_relaxed);
+      v.min = min.load(std::memory_order_relaxed);
+      v.max = max.load(std::memory_order_relaxed);
+      if(const counter * b = buckets.load(std::memory_order_acquire)) {
+        v.buckets.resize(hist_buckets::size);
+        for(std::size_t i = 0; i < hist_buckets::size; ++i)
+          v.buckets[i] = b[i].load(std::memory_order_relaxed);
+      }
+      return v;
+    }
+
+    static std::string format(const double v, const double scale) {
+      if(Time) return format_ns(scale * v);
+      char buf[32];
+      std::snprintf(buf, sizeof buf, "%.4g", v);
+      return buf;
+    }
+
+    // Edge closest to zero of the bucket holding rank p * count, clamped to
+    // [min, max], max itself for its own bucket
+    static double percentile(const value & v, const double p) noexcept {
+      const std::uint64_t rank = std::max<std::uint64_t>(1,
+        static_cast<std::uint64_t>(std::ceil(p * static_cast<double>(v.count))));
+      std::uint64_t seen = 0;
+      std::size_t i = 0;
+      while(i + 1 < v.buckets.size() && (seen += v.buckets[i]) < rank) ++i;
+      if(i == hist_buckets::index(v.max)) return v.max;
+      return std::min(v.max, std::max(v.min, hist_buckets::value(i)));
+    }
+
+    template <typename Rows>                   // site_table<hist_slot>::rows
+    static void print(const DebugPrinter & d, const Rows & rows) {
+      const double scale = Time ? tick_clock::ns_per_tick() : 1;
+      bool header = false;
+      std::ostream & out = *d.outstream;
+      for(const auto & r : rows) {
+        const value & v = r.second;
+        if(v.count == 0) continue;
+        if(!header)
+          out << d.hcol_ << (Time ? "DebugPrinter timer histograms:"
+                                  : "DebugPrinter histograms:") << d.hcol_r_ << std::endl;
+        header = true;
+        out << "  " << r.first.label << " (" << r.first.file << ":"
+            << r.first.line << ")  n=" << v.count
+            << "  min=" << format(v.min, scale)
+            << "  mean=" << format(v.sum / static_cast<double>(v.count), scale)
+            << "  max=" << format(v.max, scale) << std::endl << "   ";
+        for(const double p : {0.5, 0.9, 0.99, 0.999, 0.9999}) {
+          char name[16];
+          std::snprintf(name, sizeof name, "p%g", 100 * p);
+          out << "  " << name << "=" << format(percentile(v, p), scale);
+        }
+        out << std::endl;
 
-  
+        // One bar per power of two between min and max, empty runs as ...
+        std::vector<std::uint64_t> bars(hist_buckets::bars);
+        for(std::size_t i = 0; i < v.buckets.size(); ++i)
+          bars[hist_buckets::bar(i)] += v.buckets[i];
+        std::size_t lo = 0, hi = bars.size();
+        while(lo < hi && bars[lo] == 0) ++lo;
+        while(hi > lo && bars[hi - 1] == 0) --hi;
+        const std::uint64_t top = *std::max_element(bars.begin(), bars.end());
+        for(std::size_t o = lo; o < hi; ++o) {
+          if(bars[o] == 0) {
+            if(bars[o - 1] != 0) out << std::setw(14) << "..." << " |" << std::endl;
+            continue;
+          }
+          const std::size_t bar = static_cast<std::size_t>(
+            40 * static_cast<double>(bars[o]) / static_cast<double>(top) + 0.5);
+          out << std::setw(14) << format(hist_buckets::bar_lower(o), scale)
+              << " |" << std::string(bar, '#') << std::string(40 - bar, ' ')
+              << " " << bars[o] << std::endl;
+        }
+      }
+    }
+  };
 
   // Used to split mods for type()/type_of()
   std::pair<std::string, std::string> mod_split(const std::string & s) const {
@@ -665,6 +5698,12 @@ class DebugPrinter {
 
 };
 
+/// \cond DEBUGPRINTER_DONOTDOCME_HAVESOMEDECENCY_PLEASE
+template <typename E, long long... I>
+constexpr DebugPrinter::enum_name
+DebugPrinter::enum_table<E, std::integer_sequence<long long, I...>>::names[];
+/// \endcond
+
 /*******************************************************************************
  * std::ostream overloads
  */
@@ -672,12 +5711,15 @@ class DebugPrinter {
 /// \brief operator<< overload for std::ostream
 template <typename T>
 DebugPrinter & operator<<(DebugPrinter & d, const T& output) {
+  static_assert(DebugPrinter::is_printable<T>(),
+                "DebugPrinter error: object has no suitable operator<< overload");
   std::ostream & out = *d.outstream;
   std::streamsize savep = out.precision();
   std::ios_base::fmtflags savef =
       out.setf(std::ios_base::fixed, std::ios::floatfield);
-  out << std::setprecision(static_cast<int>(d.prec_)) << std::fixed << output
-      << std::setprecision(static_cast<int>(savep));
+  out << std::setprecision(static_cast<int>(d.prec_)) << std::fixed;
+  d.format(out, output);
+  out << std::setprecision(static_cast<int>(savep));
   out.setf(savef, std::ios::floatfield);
   out.flush();
   return d;
@@ -713,12 +5755,207 @@ inline DebugPrinter & operator,(DebugPrinter & d,
 /// \brief Static global heap-allocated object
 static DebugPrinter& dout = *new DebugPrinter;
 
+#ifdef DEBUGPRINTER_USDT
+/*******************************************************************************
+ * USDT probes
+ */
+
+/** \brief SystemTap/USDT probes of the `dout_*` macros (`DEBUGPRINTER_USDT`)
+ *  \details Every use of a macro adds a probe point (a `nop` and a
+ *  `.note.stapsdt` ELF note) named `debugprinter:<probe>`. Its arguments are
+ *  only computed, and values only formatted, while a tracer is attached,
+ *  that is while the semaphore of the probe is raised; otherwise a probe
+ *  costs one load and branch. Strings are `const char *`, the line and
+ *  counts are 64-bit integers. Probes and arguments:
+ *
+ *  probe   | from                   | arguments
+ *  ------- | ---------------------- | --------------------------------
+ *  here    | dout_HERE              | file, line, function
+ *  val     | dout_VAL               | file, line, expression, value text
+ *  count   | dout_COUNT(_N)         | name, increment
+ *  hist    | dout_HIST              | name, value text
+ *  stat    | dout_STAT(_LAST)       | expression, value text
+ *  instant | dout_TRACE_INSTANT     | name
+ *  counter | dout_TRACE_COUNTER     | name, value text
+ *  trip    | dout_TRIP              | name, trip count
+ *  branch  | dout_BRANCH            | file, line, condition, outcome (0, 1)
+ *  scope   | dout_TIMER, dout_SCOPE | file, line, name (on entry)
+ *  dump    | dout_SUMMARY, dout_HEX | file, line, macro, expression
+ *
+ *  `scope` also fires in dout_TIMER_CPU, dout_THROUGHPUT, dout_HIST_TIMER,
+ *  dout_PERF and dout_RUSAGE(_EVERY), `dump` in dout_CHECK_FINITE, dout_DIFF
+ *  and dout_HASH(_CHANGED); the latter only pass the expression, as their
+ *  output spans many lines. The remaining macros print no values of their
+ *  own (dout_FUNC, dout_STACK, dout_TYPE, dout_PAUSE), write files
+ *  (dout_NPY, dout_ROW) or only scope other events (dout_FLOW) and have no
+ *  probe.
+ *
+ *  Example usage:
+ *  ~~~{.sh}
+ *      bpftrace -e 'usdt:./app:debugprinter:val { printf("%s = %s\n",
+ *                   str(arg2), str(arg3)); }' -p $(pidof app)
+ *  ~~~
+ */
+namespace usdt {
+
+/// \cond DEBUGPRINTER_DONOTDOCME_HAVESOMEDECENCY_PLEASE
+// Raised by tracers attached to a probe. Weak, so that every translation
+// unit can define them; shared by all sites of a probe.
+extern "C" {
+  __attribute__((weak, section(".probes"))) volatile unsigned short debugprinter_here_semaphore;
+  __attribute__((weak, section(".probes"))) volatile unsigned short debugprinter_val_semaphore;
+  __attribute__((weak, section(".probes"))) volatile unsigned short debugprinter_count_semaphore;
+  __attribute__((weak, section(".probes"))) volatile unsigned short debugprinter_hist_semaphore;
+  __attribute__((weak, section(".probes"))) volatile unsigned short debugprinter_stat_semaphore;
+  __attribute__((weak, section(".probes"))) volatile unsigned short debugprinter_instant_semaphore;
+  __attribute__((weak, section(".probes"))) volatile unsigned short debugprinter_counter_semaphore;
+  __attribute__((weak, section(".probes"))) volatile unsigned short debugprinter_trip_semaphore;
+  __attribute__((weak, section(".probes"))) volatile unsigned short debugprinter_branch_semaphore;
+  __attribute__((weak, section(".probes"))) volatile unsigned short debugprinter_scope_semaphore;
+  __attribute__((weak, section(".probes"))) volatile unsigned short debugprinter_dump_semaphore;
+}
+
+// Probe point with its stapsdt note (version 3, as <sys/sdt.h>), in the
+// section group of the enclosing function
+#define DEBUGPRINTER_USDT_NOTE(name, args)                                     \
+  "990: nop\n"                                                                 \
+  ".pushsection .note.stapsdt,\"?\",\"note\"\n"                                \
+  ".balign 4\n"                                                                \
+  ".4byte 992f-991f, 994f-993f, 3\n"                                           \
+  "991: .asciz \"stapsdt\"\n"                                                  \
+  "992: .balign 4\n"                                                           \
+  "993: .8byte 990b\n"                                                         \
+  ".8byte _.stapsdt.base\n"                                                    \
+  ".8byte debugprinter_" #name "_semaphore\n"                                  \
+  ".asciz \"debugprinter\"\n"                                                  \
+  ".asciz \"" #name "\"\n"                                                     \
+  ".asciz \"" args "\"\n"                                                      \
+  "994: .balign 4\n"                                                           \
+  ".popsection\n"                                                              \
+  ".ifndef _.stapsdt.base\n"                                                   \
+  ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"      \
+  ".weak _.stapsdt.base\n"                                                     \
+  ".hidden _.stapsdt.base\n"                                                   \
+  "_.stapsdt.base: .space 1\n"                                                 \
+  ".size _.stapsdt.base, 1\n"                                                  \
+  ".popsection\n"                                                              \
+  ".endif\n"
+
+// Inlined into the macros, so that every use gets its own probe point
+#define DEBUGPRINTER_USDT_INLINE inline __attribute__((always_inline))
+
+#define DEBUGPRINTER_USDT_OFF(name)                                            \
+  __builtin_expect(debugprinter_##name##_semaphore == 0, 1)
+
+DEBUGPRINTER_USDT_INLINE void here(const char * file, const long long line,
+                                   const char * func) {
+  if(DEBUGPRINTER_USDT_OFF(here)) return;
+  __asm__ __volatile__(DEBUGPRINTER_USDT_NOTE(here, "8@%[a0] -8@%[a1] 8@%[a2]")
+                       :: [a0] "r"(file), [a1] "r"(line), [a2] "r"(func));
+}
+
+template <typename T>
+DEBUGPRINTER_USDT_INLINE void val(const char * file, const long long line,
+                                  const char * expr, const T & obj) {
+  if(DEBUGPRINTER_USDT_OFF(val)) return;
+  const std::string text = dout.detail_.text(obj);
+  __asm__ __volatile__(DEBUGPRINTER_USDT_NOTE(val, "8@%[a0] -8@%[a1] 8@%[a2] 8@%[a3]")
+                       :: [a0] "r"(file), [a1] "r"(line), [a2] "r"(expr),
+                          [a3] "r"(text.c_str()));
+}
+
+template <typename N>
+DEBUGPRINTER_USDT_INLINE void count(const N & name, const std::uint64_t n) {
+  if(DEBUGPRINTER_USDT_OFF(count)) return;
+  const std::string s(name);
+  __asm__ __volatile__(DEBUGPRINTER_USDT_NOTE(count, "8@%[a0] 8@%[a1]")
+                       :: [a0] "r"(s.c_str()), [a1] "r"(n));
+}
+
+template <typename N>
+DEBUGPRINTER_USDT_INLINE void hist(const N & name, const double value) {
+  if(DEBUGPRINTER_USDT_OFF(hist)) return;
+  const std::string s(name), text = dout.detail_.text(value);
+  __asm__ __volatile__(DEBUGPRINTER_USDT_NOTE(hist, "8@%[a0] 8@%[a1]")
+                       :: [a0] "r"(s.c_str()), [a1] "r"(text.c_str()));
+}
+
+DEBUGPRINTER_USDT_INLINE void stat(const char * expr, const double value) {
+  if(DEBUGPRINTER_USDT_OFF(stat)) return;
+  const std::string text = dout.detail_.text(value);
+  __asm__ __volatile__(DEBUGPRINTER_USDT_NOTE(stat, "8@%[a0] 8@%[a1]")
+                       :: [a0] "r"(expr), [a1] "r"(text.c_str()));
+}
+
+template <typename N>
+DEBUGPRINTER_USDT_INLINE void instant(const N & name) {
+  if(DEBUGPRINTER_USDT_OFF(instant)) return;
+  const std::string s(name);
+  __asm__ __volatile__(DEBUGPRINTER_USDT_NOTE(instant, "8@%[a0]")
+                       :: [a0] "r"(s.c_str()));
+}
+
+template <typename N>
+DEBUGPRINTER_USDT_INLINE void counter(const N & name, const double value) {
+  if(DEBUGPRINTER_USDT_OFF(counter)) return;
+  const std::string s(name), text = dout.detail_.text(value);
+  __asm__ __volatile__(DEBUGPRINTER_USDT_NOTE(counter, "8@%[a0] 8@%[a1]")
+                       :: [a0] "r"(s.c_str()), [a1] "r"(text.c_str()));
+}
+
+template <typename N>
+DEBUGPRINTER_USDT_INLINE void trip(const N & name, const std::uint64_t n) {
+  if(DEBUGPRINTER_USDT_OFF(trip)) return;
+  const std::string s(name);
+  __asm__ __volatile__(DEBUGPRINTER_USDT_NOTE(trip, "8@%[a0] 8@%[a1]")
+                       :: [a0] "r"(s.c_str()), [a1] "r"(n));
+}
+
+DEBUGPRINTER_USDT_INLINE void branch(const char * file, const long long line,
+                                     const char * expr, const bool taken) {
+  if(DEBUGPRINTER_USDT_OFF(branch)) return;
+  const long long t = taken;
+  __asm__ __volatile__(DEBUGPRINTER_USDT_NOTE(branch, "8@%[a0] -8@%[a1] 8@%[a2] -8@%[a3]")
+                       :: [a0] "r"(file), [a1] "r"(line), [a2] "r"(expr),
+                          [a3] "r"(t));
+}
+
+template <typename N>
+DEBUGPRINTER_USDT_INLINE void scope(const char * file, const long long line,
+                                    const N & name) {
+  if(DEBUGPRINTER_USDT_OFF(scope)) return;
+  const std::string s(name);
+  __asm__ __volatile__(DEBUGPRINTER_USDT_NOTE(scope, "8@%[a0] -8@%[a1] 8@%[a2]")
+                       :: [a0] "r"(file), [a1] "r"(line), [a2] "r"(s.c_str()));
+}
+
+DEBUGPRINTER_USDT_INLINE void dump(const char * file, const long long line,
+                                   const char * macro, const char * expr) {
+  if(DEBUGPRINTER_USDT_OFF(dump)) return;
+  __asm__ __volatile__(DEBUGPRINTER_USDT_NOTE(dump, "8@%[a0] -8@%[a1] 8@%[a2] 8@%[a3]")
+                       :: [a0] "r"(file), [a1] "r"(line), [a2] "r"(macro),
+                          [a3] "r"(expr));
+}
+/// \endcond
+
+} // namespace usdt
+
+#define DEBUGPRINTER_USDT_PROBE(...) fsc::usdt::__VA_ARGS__;
+#else
+#define DEBUGPRINTER_USDT_PROBE(...)
+#endif // DEBUGPRINTER_USDT
+
 /*******************************************************************************
  * Macros
  */
 
+// Unique names for the variables of scoped macros
+#define DEBUGPRINTER_CAT_IMPL(a, b) a##b
+#define DEBUGPRINTER_CAT(a, b) DEBUGPRINTER_CAT_IMPL(a, b)
+
 /** \brief Print current line in the form `filename:line (function)`
- *  \details Example usage:
+ *  \details Also an instant event of DebugPrinter::trace_start(). Example
+ *  usage:
  *  ~~~{.cpp}
  *      dout_HERE
  *  ~~~
@@ -728,9 +5965,15 @@ static DebugPrinter& dout = *new DebugPrinter;
  *  ~~~
  * \hideinitializer
  */
-#define dout_HERE fsc::dout(fsc::dout.detail_.filemacro_name(__FILE__),        \
-                            std::to_string(__LINE__)                           \
-                            + " (" + std::string(__func__) + ")",":");        //
+#define dout_HERE {                                                             \
+  static const fsc::DebugPrinter::detail::trace_site dout_trace_site_(         \
+    fsc::dout.detail_.filemacro_name(__FILE__) + ":"                           \
+    + std::to_string(__LINE__) + " (" + std::string(__func__) + ")");          \
+  dout_trace_site_.instant();                                                  \
+  DEBUGPRINTER_USDT_PROBE(here(__FILE__, __LINE__, __func__))                  \
+  fsc::dout(fsc::dout.detail_.filemacro_name(__FILE__),                        \
+            std::to_string(__LINE__)                                           \
+            + " (" + std::string(__func__) + ")",":"); }
 
 /** \brief Print current function signature
  *  \details Example usage:
@@ -765,7 +6008,10 @@ static DebugPrinter& dout = *new DebugPrinter;
  *  ~~~
  * \hideinitializer
  */
-#define dout_VAL(...) fsc::dout(#__VA_ARGS__, (__VA_ARGS__), " = ");
+#define dout_VAL(...) {                                                        \
+  const auto & dout_val_ = (__VA_ARGS__);                                      \
+  DEBUGPRINTER_USDT_PROBE(val(__FILE__, __LINE__, #__VA_ARGS__, dout_val_))    \
+  fsc::dout(#__VA_ARGS__, dout_val_, " = "); }
 
 /** \brief Print demangled type information of given type.
  *  \param ...  can't be an incomplete type.
@@ -836,6 +6082,541 @@ static DebugPrinter& dout = *new DebugPrinter;
   if(fsc::dout.detail_.pausecheck(__VA_ARGS__))                                \
     fsc::dout.detail_.pause(#__VA_ARGS__);                                    //
 
+/** \brief Print statistics of a (large) numeric range
+ *  \param ...  range of arithmetic values, e.g. `std::vector<double>` or
+ *              fsc::strided(ptr, n, stride)
+ *  \details Prints count, min and max with their index, mean, standard
+ *  deviation and the number of NaN, infinite and zero values, computed in
+ *  one vectorised pass. Example usage:
+ *  ~~~{.cpp}
+ *      std::vector<double> field(50000000);
+ *      dout_SUMMARY(field)
+ *  ~~~
+ *  Shortcut for:
+ *  ~~~{.cpp}
+ *      fsc::dout.summary("field", field);
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_SUMMARY(...) {                                                    \
+  DEBUGPRINTER_USDT_PROBE(dump(__FILE__, __LINE__, "summary", #__VA_ARGS__))   \
+  fsc::dout.summary(#__VA_ARGS__, (__VA_ARGS__)); }
+
+/** \brief Print a hex dump of a memory region
+ *  \param ...  pointer, number of bytes and optionally the group size (bytes
+ *              per column, 1, 2 (default), 4, 8 or 16)
+ *  \details Prints the `xxd` layout: offset, hex bytes and ASCII column. Only
+ *  the head and tail of buffers longer than DebugPrinter::set_max_bytes() are
+ *  shown. Example usage:
+ *  ~~~{.cpp}
+ *      dout_HEX(frame.data(), frame.size())
+ *      dout_HEX(&header, sizeof(header), 4)
+ *  ~~~
+ *  Shortcut for:
+ *  ~~~{.cpp}
+ *      fsc::dout.hex("frame.data(), frame.size()", frame.data(), frame.size());
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_HEX(...) {                                                        \
+  DEBUGPRINTER_USDT_PROBE(dump(__FILE__, __LINE__, "hex", #__VA_ARGS__))       \
+  fsc::dout.hex(#__VA_ARGS__, __VA_ARGS__); }
+
+/** \brief Report NaN and infinite values in a range
+ *  \param ...  floating point range, or range and projection
+ *  \details Silent if all values are finite, otherwise prints the number of
+ *  offenders, the first one and a stack trace. Example usage:
+ *  ~~~{.cpp}
+ *      dout_CHECK_FINITE(field)
+ *      dout_CHECK_FINITE(particles, [](const Particle & p) { return p.vx; })
+ *  ~~~
+ *  Shortcut for:
+ *  ~~~{.cpp}
+ *      fsc::dout.check_finite("field", field);
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_CHECK_FINITE(...) {                                               \
+  DEBUGPRINTER_USDT_PROBE(dump(__FILE__, __LINE__, "check_finite", #__VA_ARGS__))\
+  fsc::dout.check_finite(#__VA_ARGS__, __VA_ARGS__); }
+
+/** \brief Compare two numeric ranges within a tolerance
+ *  \param ...  tested range, reference range, absolute and optionally
+ *              relative tolerance
+ *  \details Prints the mismatch count, the largest errors and the first
+ *  mismatching values. Example usage:
+ *  ~~~{.cpp}
+ *      dout_DIFF(fast, ref, 1e-12)
+ *      dout_DIFF(fast, ref, 0, 1e-6)
+ *  ~~~
+ *  Shortcut for:
+ *  ~~~{.cpp}
+ *      fsc::dout.diff("fast, ref, 1e-12", fast, ref, 1e-12);
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_DIFF(...) {                                                       \
+  DEBUGPRINTER_USDT_PROBE(dump(__FILE__, __LINE__, "diff", #__VA_ARGS__))      \
+  fsc::dout.diff(#__VA_ARGS__, __VA_ARGS__); }
+
+/** \brief Print a 64-bit fingerprint of a buffer or object
+ *  \param ...  range of trivially copyable values, or trivially copyable object
+ *  \details Example usage:
+ *  ~~~{.cpp}
+ *      dout_HASH(grid)
+ *  ~~~
+ *  Shortcut for:
+ *  ~~~{.cpp}
+ *      fsc::dout.hash("grid", grid);
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_HASH(...) {                                                       \
+  DEBUGPRINTER_USDT_PROBE(dump(__FILE__, __LINE__, "hash", #__VA_ARGS__))      \
+  fsc::dout.hash(#__VA_ARGS__, (__VA_ARGS__)); }
+
+/** \brief Print a fingerprint only if it changed since the last pass here
+ *  \param ...  see dout_HASH
+ *  \details Each use keeps its own last fingerprint. Example usage:
+ *  ~~~{.cpp}
+ *      for(int step = 0; step < n; ++step) {
+ *          update(grid);
+ *          dout_HASH_CHANGED(grid)
+ *      }
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_HASH_CHANGED(...) {                                               \
+  static std::atomic<std::uint64_t> dout_hash_last_(0);                        \
+  static std::atomic<bool> dout_hash_seen_(false);                             \
+  DEBUGPRINTER_USDT_PROBE(dump(__FILE__, __LINE__, "hash_changed",             \
+                               #__VA_ARGS__))                                  \
+  fsc::dout.hash_changed(#__VA_ARGS__, (__VA_ARGS__), dout_hash_last_,         \
+                         dout_hash_seen_); }
+
+/** \brief Write a numeric range to a NumPy `.npy` file
+ *  \param ...  range, optionally file name (empty: automatic) and shape
+ *  \details Without file name, each pass writes a new file named after the
+ *  source file, line and hit count, e.g. `solver_120_0.npy`,
+ *  `solver_120_1.npy`. Example usage:
+ *  ~~~{.cpp}
+ *      dout_NPY(rho)
+ *      dout_NPY(rho, "rho.npy", {nx, ny, nz})
+ *      dout_NPY(rho, "", {nx, ny, nz})
+ *  ~~~
+ *  Shortcut for:
+ *  ~~~{.cpp}
+ *      fsc::dout.npy("rho.npy", rho, {nx, ny, nz});
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_NPY(...) {                                                        \
+  static std::atomic<unsigned> dout_npy_hits_(0);                              \
+  fsc::dout.detail_.npy(__FILE__, __LINE__, dout_npy_hits_++, __VA_ARGS__); }
+
+/** \brief Append a row of numbers to a per-site CSV file
+ *  \param ...  pairs of column name (string literal) and number
+ *  \details Values are buffered in binary and formatted in chunks into
+ *  `<file stem>_<line>.csv`. Column names are taken from the first pass,
+ *  the file is complete once the program exits. Example usage:
+ *  ~~~{.cpp}
+ *      for(int it = 0; it < n; ++it) {
+ *          r = step();
+ *          dout_ROW("iter", it, "residual", r, "dt", dt)
+ *      }
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_ROW(...) {                                                        \
+  static fsc::DebugPrinter::detail::row_sink dout_row_sink_(                   \
+    fsc::dout, __FILE__, __LINE__);                                            \
+  dout_row_sink_.append(__VA_ARGS__); }
+
+/** \brief Append a row of numbers to a CSV or .npy file
+ *  \param path  file name, written as .npy structured array if it ends in
+ *               ".npy" (one field per column), as CSV otherwise
+ *  \param ...   pairs of column name (string literal) and number
+ *  \details Example usage:
+ *  ~~~{.cpp}
+ *      dout_ROW_TO("trace.npy", "iter", it, "residual", r)
+ *  ~~~
+ *  Load with `numpy.load("trace.npy")["residual"]`.
+ * \hideinitializer
+ */
+#define dout_ROW_TO(path, ...) {                                               \
+  static fsc::DebugPrinter::detail::row_sink dout_row_sink_(                   \
+    fsc::dout, __FILE__, __LINE__, path);                                      \
+  dout_row_sink_.append(__VA_ARGS__); }
+
+/** \brief Time the enclosing scope
+ *  \param label  name of the timer in the report
+ *  \details Accumulates count, total, mean, min and max time per use site
+ *  and thread, printed by DebugPrinter::report() and at program exit. Reads
+ *  the time stamp counter (tens of cycles per pass) and subtracts the timer
+ *  overhead, so regions of a few nanoseconds can be timed. Example usage:
+ *  ~~~{.cpp}
+ *      for(auto & cell : cells) {
+ *          dout_TIMER("update cell")
+ *          update(cell);
+ *      }
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_TIMER(label)                                                      \
+  static fsc::DebugPrinter::detail::timer_site                                 \
+    DEBUGPRINTER_CAT(dout_timer_site_, __LINE__)(                              \
+      fsc::dout, label, __FILE__, __LINE__, false);                            \
+  DEBUGPRINTER_USDT_PROBE(scope(__FILE__, __LINE__, label))                    \
+  fsc::DebugPrinter::detail::timer DEBUGPRINTER_CAT(dout_timer_, __LINE__)(    \
+    DEBUGPRINTER_CAT(dout_timer_site_, __LINE__));
+
+/** \brief Time the enclosing scope as a node of the call tree
+ *  \param name  name of the scope in the report
+ *  \details Nested dout_SCOPEs (also across function calls) form a call
+ *  tree per thread. DebugPrinter::report() merges the trees of all threads
+ *  and prints calls, inclusive and exclusive time of every path, indented
+ *  and with percentages of the total. Passing a scope does not allocate
+ *  once its path has been seen. Example usage:
+ *  ~~~{.cpp}
+ *      void step() {
+ *          dout_SCOPE("step")
+ *          { dout_SCOPE("forces")  forces(); }
+ *          { dout_SCOPE("advance") advance(); }
+ *      }
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_SCOPE(name)                                                       \
+  static const fsc::DebugPrinter::detail::scope_site                           \
+    DEBUGPRINTER_CAT(dout_scope_site_, __LINE__)(                              \
+      fsc::dout, name, __FILE__, __LINE__);                                    \
+  DEBUGPRINTER_USDT_PROBE(scope(__FILE__, __LINE__, name))                     \
+  fsc::DebugPrinter::detail::scope DEBUGPRINTER_CAT(dout_scope_, __LINE__)(    \
+    DEBUGPRINTER_CAT(dout_scope_site_, __LINE__));
+
+/** \brief Time the enclosing scope and report its throughput
+ *  \param label  name of the timer in the report
+ *  \param bytes  bytes read and written by the scope
+ *  \param items  elements processed by the scope, 0 if not of interest
+ *  \details Like dout_TIMER, additionally reporting the bandwidth (total
+ *  bytes over total time, in GB/s) and the item rate, plus the fraction of
+ *  DebugPrinter::set_peak_bandwidth() if set. Example usage:
+ *  ~~~{.cpp}
+ *      void axpy(double a, const double * x, double * y, std::size_t n) {
+ *          dout_THROUGHPUT("axpy", 3 * n * sizeof(double), n)
+ *          for(std::size_t i = 0; i < n; ++i)
+ *              y[i] += a * x[i];
+ *      }
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_THROUGHPUT(label, bytes, items)                                   \
+  static const fsc::DebugPrinter::detail::throughput_site                      \
+    DEBUGPRINTER_CAT(dout_throughput_site_, __LINE__)(                         \
+      fsc::dout, label, __FILE__, __LINE__);                                   \
+  DEBUGPRINTER_USDT_PROBE(scope(__FILE__, __LINE__, label))                    \
+  fsc::DebugPrinter::detail::throughput                                        \
+    DEBUGPRINTER_CAT(dout_throughput_, __LINE__)(                              \
+      DEBUGPRINTER_CAT(dout_throughput_site_, __LINE__),                       \
+      static_cast<std::uint64_t>(bytes), static_cast<std::uint64_t>(items));
+
+/** \brief Restore a flow ID for the enclosing scope
+ *  \param id  from DebugPrinter::flow_capture()
+ *  \details Sets the flow ID of the calling thread until the end of the
+ *  scope (restoring the previous one) and, while tracing, ends the arrow
+ *  from the flow_capture() of the same ID. Example usage:
+ *  ~~~{.cpp}
+ *      void run(Task & t) {
+ *          dout_FLOW(t.flow)
+ *          dout_VAL(t.size)               // [flow 7] t.size = 3
+ *      }
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_FLOW(id)                                                          \
+  fsc::DebugPrinter::detail::flow_scope                                        \
+    DEBUGPRINTER_CAT(dout_flow_, __LINE__)(id);
+
+/** \brief Mark a point in time in the timeline
+ *  \param name  name of the event
+ *  \details Recorded only between DebugPrinter::trace_start() and
+ *  DebugPrinter::trace_stop(). Example usage:
+ *  ~~~{.cpp}
+ *      dout_TRACE_INSTANT("frame")
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_TRACE_INSTANT(name) {                                             \
+  static const fsc::DebugPrinter::detail::trace_site dout_trace_site_(name);   \
+  dout_trace_site_.instant();                                                  \
+  DEBUGPRINTER_USDT_PROBE(instant(name)) }
+
+/** \brief Record the value of a counter in the timeline
+ *  \param name  name of the counter track
+ *  \param ...   value (converted to double)
+ *  \details Recorded only between DebugPrinter::trace_start() and
+ *  DebugPrinter::trace_stop(). Example usage:
+ *  ~~~{.cpp}
+ *      dout_TRACE_COUNTER("queue", q.size())
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_TRACE_COUNTER(name, ...) {                                        \
+  static const fsc::DebugPrinter::detail::trace_site dout_trace_site_(name);   \
+  const double dout_trace_v_ = static_cast<double>(__VA_ARGS__);               \
+  dout_trace_site_.counter(dout_trace_v_);                                     \
+  DEBUGPRINTER_USDT_PROBE(counter(name, dout_trace_v_)) }
+
+/** \brief Count how often this line is passed
+ *  \param name  name of the counter in the report
+ *  \details Each thread increments a counter in its own shard, the
+ *  counters are only summed by DebugPrinter::report() (at exit, on request or
+ *  periodically, see DebugPrinter::set_report_interval()). Example usage:
+ *  ~~~{.cpp}
+ *      if(!cache.find(key)) {
+ *          dout_COUNT("cache miss")
+ *      }
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_COUNT(name) dout_COUNT_N(name, 1)
+
+/** \brief Add n to a counter
+ *  \param name  name of the counter in the report
+ *  \param n     non-negative increment
+ *  \details Like dout_COUNT. Example usage:
+ *  ~~~{.cpp}
+ *      dout_COUNT_N("bytes read", got)
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_COUNT_N(name, n) {                                                \
+  static const fsc::DebugPrinter::detail::count_site dout_count_site_(         \
+    fsc::dout, name, __FILE__, __LINE__);                                      \
+  const std::uint64_t dout_count_n_ = static_cast<std::uint64_t>(n);           \
+  dout_count_site_.add(dout_count_n_);                                         \
+  DEBUGPRINTER_USDT_PROBE(count(name, dout_count_n_)) }
+
+/** \brief Count hardware events of the enclosing scope
+ *  \param label  name of the scope in the report
+ *  \details Reads a per-thread Linux `perf_event_open` counter group at the
+ *  start and the end of the scope and reports the mean per pass. The group
+ *  holds cycles, instructions, cache and branch misses of user code
+ *  (reported with IPC and misses per 1000 instructions), or, where hardware
+ *  counters are not available (virtual machines, `perf_event_paranoid`),
+ *  task clock, page faults, context switches and CPU migrations. The
+ *  counters are read with one `read` call each, which costs around a
+ *  microsecond. Elsewhere only the time is measured. Example usage:
+ *  ~~~{.cpp}
+ *      {
+ *          dout_PERF("transpose")
+ *          transpose(a, b);
+ *      }
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_PERF(label)                                                       \
+  static const fsc::DebugPrinter::detail::perf_site                            \
+    DEBUGPRINTER_CAT(dout_perf_site_, __LINE__)(                               \
+      fsc::dout, label, __FILE__, __LINE__);                                   \
+  DEBUGPRINTER_USDT_PROBE(scope(__FILE__, __LINE__, label))                    \
+  fsc::DebugPrinter::detail::perf_scope                                        \
+    DEBUGPRINTER_CAT(dout_perf_scope_, __LINE__)(                              \
+      DEBUGPRINTER_CAT(dout_perf_site_, __LINE__));
+
+/** \brief Measure the resource usage of the enclosing scope
+ *  \param label  name of the scope in the report
+ *  \details Samples `getrusage(RUSAGE_THREAD)` (user and system time, page
+ *  faults, voluntary and involuntary context switches) of the thread and
+ *  the resident set size and read/written characters of the process
+ *  (`/proc/self/statm`, `/proc/self/io`) at the start and the end of the
+ *  scope, and reports the mean deltas. The samples take some microseconds,
+ *  see dout_RUSAGE_EVERY for short scopes. Linux only, zero elsewhere.
+ *  Example usage:
+ *  ~~~{.cpp}
+ *      {
+ *          dout_RUSAGE("load")
+ *          load(path);
+ *      }
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_RUSAGE(label) dout_RUSAGE_EVERY(label, 1)
+
+/** \brief Like dout_RUSAGE, sampling only every n-th pass per thread
+ *  \param label  name of the scope in the report
+ *  \param n      sampling interval, counted per thread
+ *  \details Example usage:
+ *  ~~~{.cpp}
+ *      dout_RUSAGE_EVERY("step", 100)
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_RUSAGE_EVERY(label, n)                                            \
+  static const fsc::DebugPrinter::detail::rusage_site                          \
+    DEBUGPRINTER_CAT(dout_rusage_site_, __LINE__)(                             \
+      fsc::dout, label, __FILE__, __LINE__, n);                                \
+  DEBUGPRINTER_USDT_PROBE(scope(__FILE__, __LINE__, label))                    \
+  fsc::DebugPrinter::detail::rusage_scope                                      \
+    DEBUGPRINTER_CAT(dout_rusage_scope_, __LINE__)(                            \
+      DEBUGPRINTER_CAT(dout_rusage_site_, __LINE__));
+
+/** \brief Print the median time per evaluation of an expression
+ *  \param ...  expression, variables are captured by reference
+ *  \details Runs a warmup and then batches of evaluations until the median
+ *  is stable, see DebugPrinter::bench(). Example usage:
+ *  ~~~{.cpp}
+ *      dout_BENCH(std::sqrt(x))
+ *      dout_BENCH(std::sort(v.begin(), v.end()))
+ *  ~~~
+ *  Shortcut for:
+ *  ~~~{.cpp}
+ *      fsc::dout.bench("std::sqrt(x)", [&] { return (std::sqrt(x)); });
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_BENCH(...)                                                        \
+  fsc::dout.bench(#__VA_ARGS__, [&]() { return (__VA_ARGS__); });
+
+/** \brief Record a loop trip count or container size
+ *  \param name  name of the distribution in the report
+ *  \param ...   non-negative integer
+ *  \details Counts the exact values below 32 and one bucket per power of
+ *  two above, per thread, merged by DebugPrinter::report(). The report shows
+ *  a bar, the share and the cumulative share of every non-empty value or
+ *  bucket. Example usage:
+ *  ~~~{.cpp}
+ *      dout_TRIP("axpy n", n)
+ *      for(std::size_t i = 0; i < n; ++i)
+ *          y[i] += a * x[i];
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_TRIP(name, ...) {                                                 \
+  static const fsc::DebugPrinter::detail::trip_site dout_trip_site_(           \
+    fsc::dout, name, __FILE__, __LINE__);                                      \
+  const std::uint64_t dout_trip_n_ = static_cast<std::uint64_t>(__VA_ARGS__);  \
+  DEBUGPRINTER_USDT_PROBE(trip(name, dout_trip_n_))                            \
+  dout_trip_site_.record(dout_trip_n_); }
+
+/** \brief Count the outcomes of a condition
+ *  \param ...  condition, also the label in the report
+ *  \return the condition converted to bool
+ *  \details An expression, counting per site and thread how often the
+ *  condition is true. DebugPrinter::report() shows the ratios sorted by hits,
+ *  with a likely/unlikely hint above 90% or below 10%. Example usage:
+ *  ~~~{.cpp}
+ *      if(dout_BRANCH(n < 16))
+ *          small_path(n);
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_BRANCH(...) ([](const bool dout_branch_c_) {                      \
+  static const fsc::DebugPrinter::detail::branch_site dout_branch_site_(       \
+    fsc::dout, #__VA_ARGS__, __FILE__, __LINE__);                              \
+  DEBUGPRINTER_USDT_PROBE(branch(__FILE__, __LINE__, #__VA_ARGS__,             \
+                                 dout_branch_c_))                              \
+  return dout_branch_site_.record(dout_branch_c_);                             \
+  }(static_cast<bool>(__VA_ARGS__)))
+
+/** \brief Accumulate running statistics of a value instead of printing it
+ *  \param ...  arithmetic expression, also the label in the report
+ *  \details Folds each value into count, mean, standard deviation (Welford),
+ *  min and max of the site, kept per thread and merged by
+ *  DebugPrinter::report(). Example usage:
+ *  ~~~{.cpp}
+ *      for(int it = 0; it < max_it; ++it) {
+ *          // ...
+ *          dout_STAT(residual)
+ *      }
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_STAT(...) {                                                       \
+  static const fsc::DebugPrinter::detail::stat_site dout_stat_site_(           \
+    fsc::dout, #__VA_ARGS__, __FILE__, __LINE__);                              \
+  const double dout_stat_v_ = static_cast<double>(__VA_ARGS__);                \
+  dout_stat_site_.record(dout_stat_v_);                                        \
+  DEBUGPRINTER_USDT_PROBE(stat(#__VA_ARGS__, dout_stat_v_)) }
+
+/** \brief Like dout_STAT, also reporting the most recent value
+ *  \param ...  arithmetic expression, also the label in the report
+ *  \details The most recent value over all threads, which costs a time
+ *  stamp per call. Example usage:
+ *  ~~~{.cpp}
+ *      dout_STAT_LAST(residual)
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_STAT_LAST(...) {                                                  \
+  static const fsc::DebugPrinter::detail::stat_site dout_stat_site_(           \
+    fsc::dout, #__VA_ARGS__, __FILE__, __LINE__);                              \
+  const double dout_stat_v_ = static_cast<double>(__VA_ARGS__);                \
+  dout_stat_site_.record_last(dout_stat_v_);                                   \
+  DEBUGPRINTER_USDT_PROBE(stat(#__VA_ARGS__, dout_stat_v_)) }
+
+/** \brief Record a value into a histogram
+ *  \param name  name of the histogram in the report
+ *  \param ...   value (converted to double)
+ *  \details Log-linear buckets with 32 steps per power of two (relative
+ *  error below 3%, exact for integers below 64) over magnitudes [2^-16, 2^48)
+ *  of either sign, kept per thread and merged by DebugPrinter::report().
+ *  Magnitudes below 2^-16 share one bucket with zero. Prints count,
+ *  min, mean, max, percentiles up to p99.99 and one bar per power of two
+ *  (labelled with its lowest value). Recording
+ *  takes a few nanoseconds and allocates only on the first pass of a thread.
+ *  Example usage:
+ *  ~~~{.cpp}
+ *      dout_HIST("batch size", batch.size())
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_HIST(name, ...) {                                                 \
+  static const fsc::DebugPrinter::detail::hist_site<false> dout_hist_site_(    \
+    fsc::dout, name, __FILE__, __LINE__);                                      \
+  const double dout_hist_v_ = static_cast<double>(__VA_ARGS__);                \
+  dout_hist_site_.record(dout_hist_v_);                                        \
+  DEBUGPRINTER_USDT_PROBE(hist(name, dout_hist_v_)) }
+
+/** \brief Record the time of the enclosing scope into a histogram
+ *  \param name  name of the histogram in the report
+ *  \details Like dout_TIMER, reporting percentiles of the durations instead
+ *  of their mean. Example usage:
+ *  ~~~{.cpp}
+ *      void handle(const Request & r) {
+ *          dout_HIST_TIMER("handle")
+ *          // ...
+ *      }
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_HIST_TIMER(name)                                                  \
+  static const fsc::DebugPrinter::detail::hist_site<true>                      \
+    DEBUGPRINTER_CAT(dout_hist_site_, __LINE__)(                               \
+      fsc::dout, name, __FILE__, __LINE__);                                    \
+  DEBUGPRINTER_USDT_PROBE(scope(__FILE__, __LINE__, name))                     \
+  fsc::DebugPrinter::detail::hist_timer                                        \
+    DEBUGPRINTER_CAT(dout_hist_timer_, __LINE__)(                              \
+      DEBUGPRINTER_CAT(dout_hist_site_, __LINE__));
+
+/** \brief Time the enclosing scope, including thread CPU time
+ *  \param label  name of the timer in the report
+ *  \details Like dout_TIMER, also reports the mean CPU time of the thread per
+ *  pass (`CLOCK_THREAD_CPUTIME_ID`, a system call: use on coarse regions).
+ *  Example usage:
+ *  ~~~{.cpp}
+ *      dout_TIMER_CPU("io wait")
+ *  ~~~
+ * \hideinitializer
+ */
+#define dout_TIMER_CPU(label)                                                  \
+  static fsc::DebugPrinter::detail::timer_site                                 \
+    DEBUGPRINTER_CAT(dout_timer_site_, __LINE__)(                              \
+      fsc::dout, label, __FILE__, __LINE__, true);                             \
+  DEBUGPRINTER_USDT_PROBE(scope(__FILE__, __LINE__, label))                    \
+  fsc::DebugPrinter::detail::timer DEBUGPRINTER_CAT(dout_timer_, __LINE__)(    \
+    DEBUGPRINTER_CAT(dout_timer_site_, __LINE__));
+
 /**
  * End DebugPrinter implementation
  ******************************************************************************/
@@ -848,8 +6629,44 @@ class DebugPrinter {
   inline void operator=(std::ostream &&) {}
   inline void set_precision(const int) noexcept {}
   inline void set_color(...) noexcept {}
-  inline void operator()(...) const {}
+  inline void set_max_elements(...) noexcept {}
+  inline void set_max_bytes(...) noexcept {}
+  inline void set_peak_bandwidth(...) noexcept {}
+  template <typename... T> inline void operator()(const T &...) const {}
   inline void stack(...) const {}
+  template <typename... T> inline void summary(const T &...) const {}
+  template <typename... T> inline void hex(const T &...) const {}
+  template <typename... T> inline std::size_t diff(const T &...) const {
+    return 0;
+  }
+  template <typename... T> inline std::uint64_t hash(const T &...) const {
+    return 0;
+  }
+  template <typename... T> inline bool hash_changed(const T &...) const {
+    return false;
+  }
+  template <typename R>
+  inline bool npy(const std::string &, const R &,
+                  const std::initializer_list<std::size_t> = {}) const {
+    return false;
+  }
+  inline void report() const {}
+  inline void set_report_at_exit(...) const noexcept {}
+  inline void set_report_interval(...) const {}
+  inline void set_instrument_filter(const std::vector<std::string> &,
+                                    const std::vector<std::string> & = {}) const {}
+  inline void set_instrument(...) const noexcept {}
+  template <typename... T> inline double bench(const T &...) const {
+    return 0;
+  }
+  inline void trace_start(...) const {}
+  inline bool trace_stop() const { return false; }
+  inline std::uint64_t flow() const noexcept { return 0; }
+  inline void set_flow(...) const noexcept {}
+  inline std::uint64_t flow_capture() const { return 0; }
+  template <typename... T> inline bool check_finite(const T &...) const {
+    return true;
+  }
 };
 
 template <typename T>
@@ -863,13 +6680,41 @@ inline DebugPrinter & operator,(DebugPrinter & d,
 
 static DebugPrinter dout;
 
-#define dout_HERE ;
+#define dout_HERE {}
 #define dout_FUNC ;
-#define dout_VAL(...) ;
+#define dout_VAL(...) {}
 #define dout_TYPE(...) ;
 #define dout_TYPE_OF(...) ;
 #define dout_STACK ;
 #define dout_PAUSE(...) ;
+#define dout_SUMMARY(...) {}
+#define dout_HEX(...) {}
+#define dout_CHECK_FINITE(...) {}
+#define dout_DIFF(...) {}
+#define dout_HASH(...) {}
+#define dout_HASH_CHANGED(...) {}
+#define dout_NPY(...) {}
+#define dout_ROW(...) {}
+#define dout_ROW_TO(...) {}
+#define dout_TIMER(...) ;
+#define dout_TIMER_CPU(...) ;
+#define dout_SCOPE(...) ;
+#define dout_HIST(...) {}
+#define dout_STAT(...) {}
+#define dout_TRIP(...) {}
+#define dout_PERF(...) ;
+#define dout_RUSAGE(...) ;
+#define dout_RUSAGE_EVERY(...) ;
+#define dout_BRANCH(...) (static_cast<bool>(__VA_ARGS__))
+#define dout_STAT_LAST(...) {}
+#define dout_COUNT(...) {}
+#define dout_TRACE_INSTANT(...) {}
+#define dout_FLOW(...) ;
+#define dout_TRACE_COUNTER(...) {}
+#define dout_THROUGHPUT(...) ;
+#define dout_COUNT_N(...) {}
+#define dout_HIST_TIMER(...) ;
+#define dout_BENCH(...) ;
 
 #endif // DEBUGPRINTER_OFF
 
@@ -885,5 +6730,24 @@ namespace detail {
 
 } // namespace fsc
 
+#if defined(DEBUGPRINTER_INSTRUMENT) && !defined(DEBUGPRINTER_OFF)
+/// \cond DEBUGPRINTER_DONOTDOCME_HAVESOMEDECENCY_PLEASE
+extern "C" {
+  DEBUGPRINTER_NO_INSTRUMENT
+  void __cyg_profile_func_enter(void * fn, void *) {
+    fsc::DebugPrinter::detail::instrument_enter(fn);
+  }
+  DEBUGPRINTER_NO_INSTRUMENT
+  void __cyg_profile_func_exit(void *, void *) {
+    fsc::DebugPrinter::detail::instrument_exit();
+  }
+}
+namespace {
+  const bool debugprinter_instrument_registered =
+    fsc::DebugPrinter::detail::instrument_register(fsc::dout);
+}
+/// \endcond
+#endif // DEBUGPRINTER_INSTRUMENT
+
 #endif // DEBUGPRINTER_HEADER
 
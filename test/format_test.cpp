@@ -0,0 +1,149 @@
+/** ****************************************************************************
+ * \file    format_test.cpp
+ * \brief   Tests the DebugPrinter object formatting
+ * \author
+ * Year      | Name
+ * --------: | :------------
+ * 2026      | C.Frescolino
+ * \copyright  see LICENSE
+ ******************************************************************************/
+
+#include <catch.hpp>
+#include <fsc/DebugPrinter.hpp>
+
+#include <sstream>
+#include <vector>
+#include <list>
+#include <forward_list>
+#include <map>
+#include <set>
+
+namespace fmt_test {
+  enum class State { Idle, Running = 2, Failed = -1 };
+  enum Plain { A, B };
+  enum class Port : unsigned short { Http = 80, Alt = 8080 };
+  enum class Color { Red, Green };
+  enum Shade { Light, Dark };
+  std::ostream & operator<<(std::ostream & os, const Color c) {
+    return os << (c == Color::Red ? "custom-red" : "custom-green");
+  }
+  std::ostream & operator<<(std::ostream & os, const Shade & s) {
+    return os << (s == Light ? "custom-light" : "custom-dark");
+  }
+}
+
+template <>
+struct fsc::DebugPrinterEnumRange<fmt_test::Port> {
+  static constexpr int min = 8000;
+  static constexpr int max = 8100;
+};
+
+namespace {
+  class NoStream { int hidden_ = 0; public: int get() const { return hidden_; } };
+  struct Point { int x; double y; };
+  struct Line { Point from, to; std::vector<int> tags; };
+  struct Empty {};
+  struct WithArray { int a[3]; double d; };    // no structured binding of 4
+  struct Base { int b; };
+  struct Derived : Base { int d; };
+
+  // Print obj through a fresh uncolored DebugPrinter
+  template <typename T>
+  std::string print(const T & obj, const std::size_t max_elements = 16) {
+    std::stringstream ss;
+    fsc::DebugPrinter d;
+    d = ss;
+    d.set_color();
+    d.set_max_elements(max_elements);
+    d("x", obj, "=");
+    return ss.str();
+  }
+}
+
+TEST_CASE("Ranges and maps", "[format]") {
+  CHECK(print(std::vector<int>{1, 2, 3}) == "x=[1, 2, 3]\n");
+  CHECK(print(std::vector<int>{}) == "x=[]\n");
+  CHECK(print(std::list<double>{0.5}) == "x=[0.5]\n");
+  CHECK(print(std::set<int>{2, 1}) == "x={1, 2}\n");
+  CHECK(print(std::map<int, std::string>{{1, "a"}, {2, "b"}})
+        == "x={1: a, 2: b}\n");
+  int arr[] = {4, 5};
+  CHECK(print(arr) == "x=[4, 5]\n");
+  CHECK(print("chars") == "x=chars\n");
+  CHECK(print(std::vector<std::vector<int>>{{1}, {}}) == "x=[[1], []]\n");
+}
+
+TEST_CASE("Element budget", "[format]") {
+  std::vector<int> v(10);
+  for(int i = 0; i < 10; ++i) v[i] = i;
+  CHECK(print(v, 4) == "x=[0, 1, ... (6 more), 8, 9]\n");
+  CHECK(print(v, 3) == "x=[0, 1, ... (7 more), 9]\n");
+  CHECK(print(v, 10) == "x=[0, 1, 2, 3, 4, 5, 6, 7, 8, 9]\n");
+  CHECK(print(v, 0) == print(v, 10));
+  std::forward_list<int> fl(v.begin(), v.end());
+  CHECK(print(fl, 4) == "x=[0, 1, ... (6 more), 8, 9]\n");
+}
+
+TEST_CASE("Tuples, pointers and durations", "[format]") {
+  CHECK(print(std::make_pair(1, 'c')) == "x=(1, c)\n");
+  CHECK(print(std::make_tuple(1, "a", std::vector<int>{2})) == "x=(1, a, [2])\n");
+  CHECK(print(std::unique_ptr<int>()) == "x=nullptr\n");
+  auto p = std::make_shared<int>(3);
+  CHECK(print(p).find(" -> 3\n") != std::string::npos);
+  CHECK(print(std::weak_ptr<int>()) == "x=expired\n");
+  CHECK(print(std::chrono::microseconds(7)) == "x=7us\n");
+  CHECK(print(std::chrono::minutes(2)) == "x=2min\n");
+}
+
+#ifdef DEBUGPRINTER_CXX17
+TEST_CASE("Optional and variant", "[format]") {
+  CHECK(print(std::optional<int>()) == "x=nullopt\n");
+  CHECK(print(std::optional<int>(4)) == "x=4\n");
+  CHECK(print(std::variant<int, std::string>("v")) == "x=v\n");
+  CHECK(print(std::variant<std::monostate, int>()) == "x=monostate\n");
+}
+#endif // DEBUGPRINTER_CXX17
+
+TEST_CASE("Aggregates", "[format]") {
+  #if defined(DEBUGPRINTER_CXX20)
+  CHECK(print(Point{1, 2.5}) == "x={x: 1, y: 2.5}\n");
+  CHECK(print(Line{{1, 2}, {3, 4}, {5}})
+        == "x={from: {x: 1, y: 2}, to: {x: 3, y: 4}, tags: [5]}\n");
+  #elif defined(DEBUGPRINTER_CXX17)
+  CHECK(print(Point{1, 2.5}) == "x={1, 2.5}\n");
+  CHECK(print(Line{{1, 2}, {3, 4}, {5}}) == "x={{1, 2}, {3, 4}, [5]}\n");
+  CHECK(print(std::vector<Point>{{0, 1}}) == "x=[{0, 1}]\n");
+  #endif
+  #ifdef DEBUGPRINTER_CXX17
+  CHECK(print(Empty{}) == "x={}\n");
+  #endif
+}
+
+TEST_CASE("Enums", "[format]") {
+  using namespace fmt_test;
+  CHECK(print(State::Running) == "x=fmt_test::State::Running (2)\n");
+  CHECK(print(State::Failed) == "x=fmt_test::State::Failed (-1)\n");
+  CHECK(print(static_cast<State>(5)) == "x=(fmt_test::State)5\n");
+  CHECK(print(B) == "x=fmt_test::Plain::B (1)\n");
+  CHECK(print(Port::Alt) == "x=fmt_test::Port::Alt (8080)\n");
+  CHECK(print(Port::Http) == "x=(fmt_test::Port)80\n");
+  CHECK(print(std::vector<State>{State::Idle})
+        == "x=[fmt_test::State::Idle (0)]\n");
+  CHECK(print(Color::Red) == "x=custom-red\n");          // own operator<<
+  CHECK(print(Dark) == "x=custom-dark\n");
+  CHECK(print(std::vector<Color>{Color::Green}) == "x=[custom-green]\n");
+  std::stringstream ss;
+  fsc::DebugPrinter d;
+  d = ss;
+  d << Color::Red << " " << State::Running;
+  CHECK(ss.str() == "custom-red fmt_test::State::Running (2)");
+}
+
+TEST_CASE("Unprintable types", "[format]") {
+  CHECK(print(NoStream()).find("has no suitable") != std::string::npos);
+  CHECK(print(std::vector<NoStream>(1)).find("has no suitable")
+        != std::string::npos);
+  CHECK(print(WithArray{{1, 2, 3}, 4}).find("has no suitable")
+        != std::string::npos);
+  CHECK(print(Derived{{1}, 2}).find("has no suitable") != std::string::npos);
+}
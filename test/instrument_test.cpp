@@ -0,0 +1,100 @@
+/** ****************************************************************************
+ * \file    instrument_test.cpp
+ * \brief   Tests the DebugPrinter -finstrument-functions recording
+ * \author
+ * Year      | Name
+ * --------: | :------------
+ * 2026      | C.Frescolino
+ * \copyright  see LICENSE
+ ******************************************************************************/
+
+// Compiled with -finstrument-functions, see CMakeLists.txt
+#define DEBUGPRINTER_INSTRUMENT
+#include <catch.hpp>
+#include <fsc/DebugPrinter.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Extern, to be found by the symbolizer of the -rdynamic unittests
+void instrument_test_leaf(int & n) { ++n; }
+void instrument_test_skipped(int & n) { ++n; }
+void instrument_test_root(int & n) {
+  for(int i = 0; i < 3; ++i) {
+    instrument_test_leaf(n);
+    instrument_test_skipped(n);
+  }
+}
+
+namespace {
+  std::vector<std::string> instrument_lines() {
+    std::stringstream ss;
+    fsc::DebugPrinter d;
+    d = ss;
+    d.set_color();
+    d.set_report_at_exit(false);
+    d.report();
+    std::vector<std::string> lines;
+    std::string line;
+    while(std::getline(ss, line))
+      if(line.find("instrument_test_") != std::string::npos)
+        lines.push_back(line);
+    return lines;
+  }
+
+  std::size_t occurrences(const std::string & s, const std::string & what) {
+    std::size_t n = 0;
+    for(std::size_t pos = s.find(what); pos != std::string::npos;
+        pos = s.find(what, pos + 1))
+      ++n;
+    return n;
+  }
+}
+
+TEST_CASE("Instrumented functions", "[profile]") {
+  fsc::dout.set_instrument_filter({"instrument_test_"}, {"skipped"});
+  int n = 0;
+  instrument_test_root(n);
+  instrument_test_root(n);
+  CHECK(n == 12);
+
+  std::vector<std::string> lines = instrument_lines();
+  REQUIRE(lines.size() == 2);
+  CHECK(lines[0].substr(50).find("instrument_test_root(int&) (") == 0);
+  CHECK(lines[1].substr(50).find("  instrument_test_leaf(int&) (") == 0);
+  CHECK(lines[0].find(":") == std::string::npos);           // module, no line
+  CHECK(std::stoul(lines[0].substr(16)) == 2);
+  CHECK(std::stoul(lines[1].substr(16)) == 6);
+
+  fsc::dout.set_instrument(false);
+  instrument_test_root(n);
+  fsc::dout.set_instrument();
+  lines = instrument_lines();
+  REQUIRE(lines.size() == 2);
+  CHECK(std::stoul(lines[0].substr(16)) == 2);
+
+  fsc::dout.set_instrument_filter({"instrument_test_"}, {"leaf", "skipped"});
+  lines = instrument_lines();
+  REQUIRE(lines.size() == 1);
+  CHECK(lines[0].substr(50).find("instrument_test_root(int&) (") == 0);
+
+  const std::string path = "instrument_test_trace.json";
+  std::stringstream ss;
+  fsc::DebugPrinter d;
+  d = ss;
+  d.set_color();
+  d.trace_start(path);
+  instrument_test_root(n);
+  REQUIRE(d.trace_stop());
+  std::ifstream in(path);
+  const std::string json((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+  std::remove(path.c_str());
+  CHECK(occurrences(json, "\"name\":\"instrument_test_root(int&)\"") == 1);
+  CHECK(occurrences(json, "instrument_test_leaf") == 0);
+  CHECK(occurrences(json, "\"ph\":\"E\"") >= 1);
+  fsc::dout.set_instrument_filter({"instrument_test_"}, {"skipped"});
+}
@@ -0,0 +1,300 @@
+/** ****************************************************************************
+ * \file    numeric_test.cpp
+ * \brief   Tests the DebugPrinter numeric inspection methods
+ * \author
+ * Year      | Name
+ * --------: | :------------
+ * 2026      | C.Frescolino
+ * \copyright  see LICENSE
+ ******************************************************************************/
+
+#include <catch.hpp>
+#include <fsc/DebugPrinter.hpp>
+
+#include <sstream>
+#include <vector>
+#include <list>
+#include <cstdint>
+#include <atomic>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+
+namespace {
+  // Fresh uncolored DebugPrinter writing into a stringstream
+  struct Printer {
+    std::stringstream ss;
+    fsc::DebugPrinter d;
+    Printer() { d = ss; d.set_color(); }
+  };
+
+  template <typename R>
+  std::string summary(const R & range) {
+    Printer p;
+    p.d.summary("x", range);
+    return p.ss.str();
+  }
+}
+
+TEST_CASE("Summary of small ranges", "[numeric]") {
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const double inf = std::numeric_limits<double>::infinity();
+  CHECK(summary(std::vector<double>{3, -1, 4, 1, -5, 9, 0, nan, -inf, -5})
+        == "x: n=10  min=-5 @4  max=9 @5  mean=0.75  std=4.3804"
+           "  nan=1  inf=1  zero=1\n");
+  CHECK(summary(std::vector<int>{5, 3, 9, -2, 9})
+        == "x: n=5  min=-2 @3  max=9 @2  mean=4.8  std=4.1183"
+           "  nan=0  inf=0  zero=0\n");
+  CHECK(summary(std::list<std::int64_t>{7}) == summary(std::vector<char>{7}));
+  CHECK(summary(std::vector<int>{123456789, 5, -2000000001}).find(
+          "min=-2000000001 @2  max=123456789 @0") != std::string::npos);
+  CHECK(summary(std::vector<std::uint32_t>(100, 4000000000u)).find(
+          "max=4000000000 @0") != std::string::npos);
+  CHECK(summary(std::vector<float>{static_cast<float>(nan)}) == "x: n=1  nan=1  inf=0  zero=0\n");
+  double arr[] = {1, 2, 3, 4, 5, 6};
+  CHECK(summary(fsc::strided(arr + 1, 3, 2))
+        == "x: n=3  min=2 @0  max=6 @2  mean=4  std=1.633"
+           "  nan=0  inf=0  zero=0\n");
+}
+
+TEST_CASE("Vectorised summary matches scalar", "[numeric]") {
+  std::vector<float> f(10007);
+  std::vector<double> d(f.size());
+  std::vector<std::int16_t> s(f.size());
+  for(std::size_t i = 0; i < f.size(); ++i) {
+    f[i] = static_cast<float>((i * 7919) % 1000) - 500.f;
+    d[i] = f[i];
+    s[i] = static_cast<std::int16_t>(f[i]);
+  }
+  f[9000] = d[9000] = std::numeric_limits<float>::infinity();
+  std::list<double> l(d.begin(), d.end());   // scalar path
+  CHECK(summary(d) == summary(l));
+  CHECK(summary(f) == summary(l));
+  s[9000] = 0;
+  l = std::list<double>(s.begin(), s.end());
+  CHECK(summary(s) == summary(l));
+}
+
+TEST_CASE("Hex dump", "[numeric]") {
+  const char msg[] = "Hello World\nThis is \x01\xff";
+  Printer p;
+  p.d.hex("msg", msg, sizeof(msg) - 1);
+  std::string dump = p.ss.str();
+  dump = dump.substr(dump.find('\n') + 1);            // skip pointer header
+  CHECK(dump == "00000000: 4865 6c6c 6f20 576f 726c 640a 5468 6973"
+                "  Hello World.This\n"
+                "00000010: 2069 7320 01ff"
+                "                            is ..\n");
+
+  Printer q;
+  q.d.hex("msg", msg, 5, 4);
+  dump = q.ss.str();
+  CHECK(dump.substr(dump.find('\n') + 1)
+        == "00000000: 48656c6c 6f                          Hello\n");
+  CHECK_THROWS_AS(q.d.hex("msg", msg, 5, 3), std::runtime_error);
+
+  std::vector<unsigned char> big(1000);
+  for(std::size_t i = 0; i < big.size(); ++i)
+    big[i] = static_cast<unsigned char>(i);
+  Printer r;
+  r.d.set_max_bytes(64);
+  r.d.hex("big", big.data(), big.size());
+  dump = r.ss.str();
+  CHECK(dump.find("00000010: 1011") != std::string::npos);
+  CHECK(dump.find("00000020:") == std::string::npos);
+  CHECK(dump.find("... (928 bytes)\n000003c0: c0c1") != std::string::npos);
+  CHECK(dump.find("000003e0: e0e1 e2e3 e4e5 e6e7                      ........\n")
+        != std::string::npos);
+}
+
+TEST_CASE("Check finite", "[numeric]") {
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const double inf = std::numeric_limits<double>::infinity();
+  std::streambuf * cerr_buf = std::cerr.rdbuf();      // no -rdynamic warnings
+  std::stringstream cerr_ss;
+  std::cerr.rdbuf(cerr_ss.rdbuf());
+
+  Printer ok;
+  CHECK(ok.d.check_finite("x", std::vector<double>{1, 2, 3}));
+  CHECK(ok.ss.str() == "");
+
+  Printer bad;
+  CHECK_FALSE(bad.d.check_finite("x", std::list<float>{1, 2, -INFINITY, NAN}));
+  const std::string out = bad.ss.str();
+  CHECK(out.substr(0, out.find('\n'))
+        == "x: 2 of 4 values not finite, first @2 = -inf");
+  CHECK(out.find("stack frames") != std::string::npos);
+
+  std::vector<double> d(10007, 1.);
+  d[5000] = nan;
+  d[9000] = inf;
+  d[10005] = -inf;
+  std::vector<float> f(d.begin(), d.end());
+  for(auto v : {fsc::strided(d.data(), d.size()), fsc::strided(d.data(), 5004, 2)}) {
+    Printer p;
+    CHECK_FALSE(p.d.check_finite("x", v));
+    CHECK(p.ss.str().substr(0, p.ss.str().find('\n'))
+          == (v.stride() == 1 ? "x: 3 of 10007 values not finite, first @5000 = nan"
+                              : "x: 2 of 5004 values not finite, first @2500 = nan"));
+  }
+  Printer pf;
+  CHECK_FALSE(pf.d.check_finite("x", f));
+  CHECK(pf.ss.str().find("x: 3 of 10007 values not finite, first @5000 = nan\n") == 0);
+
+  struct Particle { double x, vx; };
+  std::vector<Particle> parts(100, Particle{0, 1});
+  parts[42].x = nan;
+  Printer pp;
+  CHECK(pp.d.check_finite("vx", parts, [](const Particle & q) { return q.vx; }));
+  CHECK_FALSE(pp.d.check_finite("x", parts, [](const Particle & q) { return q.x; }));
+  CHECK(pp.ss.str().find("x: 1 of 100 values not finite, first @42 = nan\n") == 0);
+
+  std::cerr.rdbuf(cerr_buf);
+}
+
+TEST_CASE("Diff within tolerance", "[numeric]") {
+  Printer p;
+  CHECK(p.d.diff("x", std::vector<double>{1, 2, 3}, std::list<int>{1, 2, 3}) == 0);
+  CHECK(p.ss.str() == "x: 0 of 3 differ  max abs=0 @0  max rel=0 @0"
+                      "  (atol=0 rtol=0)\n");
+
+  Printer e;
+  CHECK(e.d.diff("x", std::vector<double>(), std::vector<double>{1}) == 1);
+  CHECK(e.ss.str().find("0 of 0 differ") != std::string::npos);
+
+  Printer q;
+  q.d.set_max_elements(2);
+  const double a[] = {1, 2.5, 3, 4, NAN, 0.5};
+  const std::vector<float> b{1, 2, 3.05f, 4, 5, 0, 7};
+  CHECK(q.d.diff("x", a, b, 0.1) == 4);
+  CHECK(q.ss.str() == "x: 3 of 6 differ  max abs=0.5 @1  max rel=inf @5"
+                      "  (atol=0.1 rtol=0)  size 6 vs 7\n"
+                      "  @1: 2.5 vs 2  diff=0.5\n"
+                      "  @4: nan vs 5  diff=nan\n"
+                      "  ... (1 more)\n");
+
+  std::vector<double> ref(10007), fast(ref.size());
+  for(std::size_t i = 0; i < ref.size(); ++i) {
+    ref[i] = static_cast<double>(i % 1000) - 500;
+    fast[i] = ref[i] * (1 + 1e-7);
+  }
+  fast[6000] += 1e-3;
+  fast[7777] = -fast[7777];
+  for(auto check : {std::make_pair(0., 1e-6), std::make_pair(1e-3, 0.)}) {
+    Printer v, s;
+    CHECK(v.d.diff("x", fast, ref, check.first, check.second)
+          == s.d.diff("x", std::list<double>(fast.begin(), fast.end()), ref,
+                      check.first, check.second));
+    CHECK(v.ss.str() == s.ss.str());
+  }
+  Printer r;
+  CHECK(r.d.diff("x", fast, ref, 0, 1e-6) == 2);
+  CHECK(r.ss.str().find("  @6000: -500 vs -500  diff=0.00095\n") != std::string::npos);
+  CHECK(r.ss.str().find("max abs=554 @7777  max rel=2 @7777") != std::string::npos);
+}
+
+TEST_CASE("Hash fingerprint", "[numeric]") {
+  std::vector<int> v(5003);
+  for(std::size_t i = 0; i < v.size(); ++i)
+    v[i] = static_cast<int>(i * 2654435761u);
+  const std::list<int> l(v.begin(), v.end());
+
+  Printer p;
+  const std::uint64_t h = p.d.hash("v", v);
+  CHECK(p.ss.str().size() == std::string("v: 0x0123456789abcdef (20012 bytes)\n").size());
+  CHECK(p.ss.str().find(" (20012 bytes)\n") != std::string::npos);
+  CHECK(p.d.hash("l", l) == h);
+  CHECK(p.d.hash("s", fsc::strided(v.data(), v.size())) == h);
+  v[4321] ^= 1;
+  CHECK(p.d.hash("v", v) != h);
+  v.pop_back();
+  CHECK(p.d.hash("v", v) != h);
+  CHECK(p.d.hash("x", 42) == p.d.hash("x", std::vector<int>{42}));
+  CHECK(p.d.hash("x", std::string("abc")) != p.d.hash("x", std::string("abd")));
+
+  Printer q;
+  std::atomic<std::uint64_t> last(p.d.hash("x", 0));   // first still prints
+  std::atomic<bool> seen(false);
+  int changes = 0;
+  for(int i = 0; i < 6; ++i)
+    changes += q.d.hash_changed("x", i / 2, last, seen);
+  CHECK(changes == 3);
+  const std::string out = q.ss.str();
+  CHECK(std::count(out.begin(), out.end(), '\n') == 3);
+
+  std::vector<bool> b1(100), b2(100);                 // hashed by value
+  b1[7] = b2[7] = true;
+  CHECK(p.d.hash("b", b1) == p.d.hash("b", b2));
+  b2[8] = true;
+  CHECK(p.d.hash("b", b1) != p.d.hash("b", b2));
+}
+
+TEST_CASE("NumPy dump", "[numeric]") {
+  auto slurp = [](const char * path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in),
+                       std::istreambuf_iterator<char>());
+  };
+  const std::vector<double> v{0, 0.5, 1, 1.5, 2, 2.5};
+  Printer p;
+  CHECK(p.d.npy("numeric_test.npy", v, {2, 3}));
+  CHECK(p.ss.str() == "numeric_test.npy: <f8 (2, 3) 48 bytes\n");
+  std::string file = slurp("numeric_test.npy");
+  REQUIRE(file.size() == 128 + 48);
+  CHECK(file.substr(0, 10) == std::string("\x93NUMPY\x01\x00\x76\x00", 10));
+  CHECK(file.substr(10, 63) == "{'descr': '<f8', 'fortran_order': False, "
+                               "'shape': (2, 3), }    ");
+  CHECK(file[127] == '\n');
+  CHECK(std::memcmp(file.data() + 128, v.data(), 48) == 0);
+
+  CHECK(p.d.npy("numeric_test.npy", std::list<std::int16_t>{1, -2, 3}));
+  file = slurp("numeric_test.npy");
+  CHECK(file.find("'descr': '<i2'") != std::string::npos);
+  CHECK(file.find("'shape': (3,)") != std::string::npos);
+  CHECK(file.substr(128) == std::string("\x01\x00\xfe\xff\x03\x00", 6));
+  std::remove("numeric_test.npy");
+
+  CHECK_THROWS_AS(p.d.npy("numeric_test.npy", v, {4, 2}), std::runtime_error);
+  Printer q;
+  CHECK_FALSE(q.d.npy("no/such/dir/x.npy", v));
+  CHECK(q.ss.str() == "DebugPrinter error: could not write no/such/dir/x.npy\n");
+}
+
+TEST_CASE("Row capture", "[numeric]") {
+  auto slurp = [](const char * path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in),
+                       std::istreambuf_iterator<char>());
+  };
+  Printer p;
+  {
+    fsc::DebugPrinter::detail::row_sink csv(p.d, __FILE__, __LINE__,
+                                            "numeric_test.csv", 64);
+    fsc::DebugPrinter::detail::row_sink npy(p.d, __FILE__, __LINE__,
+                                            "numeric_test.npy", 64);
+    for(int i = 0; i < 100; ++i) {
+      csv.append("iter", i, "half", i * 0.5, "odd", i % 2 == 1);
+      npy.append("iter", static_cast<std::int16_t>(i), "half", i * 0.5);
+    }
+  }
+  CHECK(p.ss.str() == "numeric_test.csv: iter, half, odd\n"
+                      "numeric_test.npy: iter, half\n");
+  const std::string csv = slurp("numeric_test.csv");
+  CHECK(csv.substr(0, 34) == "iter,half,odd\n0,0,0\n1,0.5,1\n2,1,0\n");
+  CHECK(csv.substr(csv.size() - 11) == "\n99,49.5,1\n");
+  CHECK(std::count(csv.begin(), csv.end(), '\n') == 101);
+
+  const std::string npy = slurp("numeric_test.npy");
+  REQUIRE(npy.size() == 128 + 100 * 10);
+  CHECK(npy.find("{'descr': [('iter', '<i2'), ('half', '<f8'), ], "
+                 "'fortran_order': False, 'shape': (100,), }") == 10);
+  std::int16_t iter;
+  double half;
+  std::memcpy(&iter, npy.data() + 128 + 99 * 10, 2);
+  std::memcpy(&half, npy.data() + 128 + 99 * 10 + 2, 8);
+  CHECK(iter == 99);
+  CHECK(half == 49.5);
+  std::remove("numeric_test.csv");
+  std::remove("numeric_test.npy");
+}
@@ -0,0 +1,506 @@
+/** ****************************************************************************
+ * \file    profile_test.cpp
+ * \brief   Tests the DebugPrinter profiling sites and report()
+ * \author
+ * Year      | Name
+ * --------: | :------------
+ * 2026      | C.Frescolino
+ * \copyright  see LICENSE
+ ******************************************************************************/
+
+#include <catch.hpp>
+#include <fsc/DebugPrinter.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+  // report() of a fresh uncolored DebugPrinter, no report at exit
+  std::string report() {
+    std::stringstream ss;
+    fsc::DebugPrinter d;
+    d = ss;
+    d.set_color();
+    d.set_report_at_exit(false);
+    d.report();
+    return ss.str();
+  }
+
+  // Report line of the site with the given label
+  std::string line_of(const std::string & label) {
+    std::stringstream ss(report());
+    std::string line;
+    while(std::getline(ss, line))
+      if(line.find("  " + label + " (") != std::string::npos)
+        return line;
+    return "";
+  }
+
+  std::size_t count_of(const std::string & label) {
+    return std::stoul(line_of(label));
+  }
+}
+
+TEST_CASE("Timer sites", "[profile]") {
+  for(int i = 0; i < 1000; ++i) {
+    dout_TIMER("timer test empty")
+  }
+  for(int i = 0; i < 3; ++i) {
+    dout_TIMER_CPU("timer test sleep")
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  CHECK(count_of("timer test empty") == 1000);
+  CHECK(count_of("timer test sleep") == 3);
+
+  const std::string out = report();
+  CHECK(out.find("DebugPrinter timers:\n") == 0);
+  CHECK(out.find("timer test sleep (profile_test.cpp:") != std::string::npos);
+  CHECK(out.find("timer test sleep") < out.find("timer test empty"));  // by total
+
+  std::stringstream sleep(line_of("timer test sleep"));
+  std::size_t count;
+  double total, mean;
+  std::string total_unit, mean_unit;
+  sleep >> count >> total >> total_unit >> mean >> mean_unit;
+  CHECK(mean_unit == "ms");
+  CHECK(mean >= 2);
+}
+
+TEST_CASE("Timer sites merge threads", "[profile]") {
+  auto work = [] {
+    for(int i = 0; i < 100; ++i) {
+      dout_TIMER("timer test threads")
+    }
+  };
+  std::vector<std::thread> threads;
+  for(int t = 0; t < 4; ++t)
+    threads.emplace_back(work);
+  threads[0].join();
+  threads[1].join();
+  work();                                   // running and exited threads
+  threads[2].join();
+  threads[3].join();
+  CHECK(count_of("timer test threads") == 500);
+}
+
+namespace {
+  void scope_test_leaf() {
+    dout_SCOPE("scope test leaf")
+  }
+  void scope_test_mid() {
+    dout_SCOPE("scope test mid")
+    scope_test_leaf();
+    scope_test_leaf();
+  }
+  void scope_test_root(const int mids, const int leaves) {
+    dout_SCOPE("scope test root")
+    for(int i = 0; i < mids; ++i)
+      scope_test_mid();
+    for(int i = 0; i < leaves; ++i)
+      scope_test_leaf();
+  }
+}
+
+TEST_CASE("Scope call tree", "[profile]") {
+  scope_test_root(10, 1);
+  std::thread worker(scope_test_root, 1, 0);
+  worker.join();
+
+  std::stringstream ss(report());
+  std::vector<std::string> lines;
+  std::string line;
+  while(std::getline(ss, line))
+    if(line.find("scope test") != std::string::npos)
+      lines.push_back(line.substr(50));      // drop the numbers
+  REQUIRE(lines.size() == 4);
+  CHECK(lines[0].find("scope test root (profile_test.cpp:") == 0);
+  CHECK(lines[1].find("  scope test mid (") == 0);
+  CHECK(lines[2].find("    scope test leaf (") == 0);
+  CHECK(lines[3].find("  scope test leaf (") == 0);
+
+  ss.clear();
+  ss.str(report());
+  std::vector<std::size_t> counts;
+  while(std::getline(ss, line))
+    if(line.find("scope test") != std::string::npos)
+      counts.push_back(std::stoul(line.substr(16)));
+  CHECK(counts == std::vector<std::size_t>{2, 11, 22, 1});
+  CHECK(report().find("DebugPrinter scopes:\n    incl    excl     count") != std::string::npos);
+}
+
+TEST_CASE("Histogram sites", "[profile]") {
+  auto work = [](const int first) {
+    for(int i = first; i <= 1000; i += 2)
+      dout_HIST("hist test", i)
+  };
+  std::thread worker(work, 2);
+  work(1);
+  worker.join();
+  for(int i = 0; i < 10; ++i) {
+    dout_HIST_TIMER("hist test timer")
+  }
+
+  std::stringstream ss(report());
+  std::string line, values;
+  while(std::getline(ss, line) && line.find("  hist test (") != 0) {}
+  std::getline(ss, values);
+  CHECK(line.find("  n=1000  min=1  mean=500.5  max=1000") != std::string::npos);
+  auto percentile = [&](const std::string & p) {
+    return std::stod(values.substr(values.find(" " + p + "=") + p.size() + 2));
+  };
+  CHECK(percentile("p50") <= 500);
+  CHECK(percentile("p50") >= 500 * (1 - 1. / 32));
+  CHECK(percentile("p90") >= 900 * (1 - 1. / 32));
+  CHECK(percentile("p99.9") == 1000);
+
+  std::getline(ss, line);                    // bars per power of two
+  CHECK(line == "             1 |                                         1");
+
+  for(int i = -1000; i < 0; ++i)
+    dout_HIST("hist test negative", i)
+  std::stringstream neg(report());
+  while(std::getline(neg, line) && line.find("  hist test negative (") != 0) {}
+  std::getline(neg, values);
+  CHECK(line.find("  n=1000  min=-1000  mean=-500.5  max=-1") != std::string::npos);
+  CHECK(percentile("p50") <= -500 * (1 - 1. / 32));
+  CHECK(percentile("p50") >= -500 * (1 + 1. / 32));
+  CHECK(percentile("p90") >= -100 * (1 + 1. / 32));
+  CHECK(percentile("p99.9") == -2);
+  std::getline(neg, line);
+  CHECK(line == "         -1024 |######################################## 489");
+  const std::string out = report();
+  CHECK(out.find("DebugPrinter timer histograms:\n  hist test timer (") != std::string::npos);
+  CHECK(out.find("  n=10  min=") != std::string::npos);
+}
+
+TEST_CASE("Counters", "[profile]") {
+  auto work = [] {
+    for(int i = 0; i < 1000; ++i) {
+      dout_COUNT("count test")
+      if(i % 10 == 0)
+        dout_COUNT_N("count test tens", 10)
+    }
+  };
+  std::vector<std::thread> threads;
+  for(int t = 0; t < 3; ++t)
+    threads.emplace_back(work);
+  work();
+  for(auto & t : threads)
+    t.join();
+  CHECK(count_of("count test") == 4000);
+  CHECK(count_of("count test tens") == 4000);
+  CHECK(report().find("DebugPrinter counters:\n") != std::string::npos);
+
+  std::stringstream ss;
+  fsc::DebugPrinter d;
+  d = ss;
+  d.set_color();
+  d.set_report_interval(0.01);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  d.set_report_interval();
+  const std::string out = ss.str();
+  CHECK(out.find("count test (profile_test.cpp:") != std::string::npos);
+  CHECK(out.find("DebugPrinter counters:") != out.rfind("DebugPrinter counters:"));
+
+  std::stringstream gone;
+  {
+    fsc::DebugPrinter local;
+    local = gone;
+    local.set_report_interval(0.01);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  }                                             // stops its reports
+  const std::size_t size = gone.str().size();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  CHECK(size > 0);
+  CHECK(gone.str().size() == size);
+}
+
+TEST_CASE("Statistics", "[profile]") {
+  auto work = [](const int first) {
+    for(int i = first; i <= 1000; i += 2) {
+      const double stat_test_x = i;
+      dout_STAT(stat_test_x)
+      dout_STAT_LAST(stat_test_x * 2)
+    }
+  };
+  std::thread worker(work, 2);
+  worker.join();
+  work(1);                                    // last value from here
+
+  std::stringstream ss(line_of("stat_test_x"));
+  std::size_t count;
+  double mean, stddev, min, max;
+  std::string last;
+  ss >> count >> mean >> stddev >> min >> max >> last;
+  CHECK(count == 1000);
+  CHECK(mean == Approx(500.5));
+  CHECK(stddev == Approx(std::sqrt(1000. * 1001 / 12)).epsilon(1e-4));
+  CHECK(min == 1);
+  CHECK(max == 1000);
+  CHECK(last == "-");
+
+  ss.clear();
+  ss.str(line_of("stat_test_x * 2"));
+  ss >> count >> mean >> stddev >> min >> max >> last;
+  CHECK(count == 1000);
+  CHECK(mean == Approx(1001));
+  CHECK(last == "1998");
+  CHECK(report().find("DebugPrinter statistics:\n     count          mean") != std::string::npos);
+}
+
+TEST_CASE("Branch outcomes", "[profile]") {
+  int small = 0;
+  for(int n = 0; n < 100; ++n)
+    if(dout_BRANCH(n < 5))
+      ++small;
+  for(int n = 0; n < 10; ++n)
+    if(dout_BRANCH(n >= 0 && n < 9))
+      ++small;
+  CHECK(small == 14);
+  CHECK(line_of("n < 5") == "           100             5     5.0%  unlikely  n < 5 ("
+                            "profile_test.cpp:" + std::to_string(__LINE__ - 7) + ")");
+  CHECK(line_of("n >= 0 && n < 9").find("            10             9    90.0%    likely  ") == 0);
+  CHECK(report().find("DebugPrinter branches:\n") != std::string::npos);
+  CHECK(report().find("n < 5") < report().find("n >= 0"));  // by hits
+}
+
+TEST_CASE("Trip counts", "[profile]") {
+  std::vector<std::size_t> sizes{0, 3, 3, 31, 32, 63, 64, 1000};
+  for(const std::size_t n : sizes)
+    dout_TRIP("trip test", n)
+
+  std::stringstream ss(report());
+  std::string line;
+  while(std::getline(ss, line) && line.find("  trip test (") != 0) {}
+  CHECK(line.find("  n=8  mean=149.5  max=1000") != std::string::npos);
+  std::vector<std::string> bars;
+  while(std::getline(ss, line) && line.find(" |") == 14)
+    bars.push_back(line.substr(0, 14) + line.substr(56));
+  CHECK(bars == (std::vector<std::string>{
+    "             0  12.5%  12.5%  1",
+    "             3  25.0%  37.5%  2",
+    "            31  12.5%  50.0%  1",
+    "         32-63  25.0%  75.0%  2",
+    "        64-127  12.5%  87.5%  1",
+    "      512-1023  12.5% 100.0%  1"}));
+}
+
+TEST_CASE("Perf counter scopes", "[profile]") {
+  for(int i = 0; i < 5; ++i) {
+    dout_PERF("perf test")
+    std::vector<char> touch(1 << 20, 1);
+    CHECK(touch.back() == 1);
+  }
+  CHECK(count_of("perf test") == 5);
+
+  const std::string out = report();
+  const std::size_t head = out.find("DebugPrinter perf counters");
+  REQUIRE(head != std::string::npos);
+  const std::string columns = out.substr(out.find('\n', head) + 1, 80);
+  CHECK(columns.find("     count       mean") == 0);
+  const bool counters = out.find("DebugPrinter perf counters per call:") == head;
+  CHECK((columns.find("cycles") != std::string::npos ||
+         columns.find("task-clock") != std::string::npos) == counters);
+}
+
+TEST_CASE("Resource usage scopes", "[profile]") {
+  std::vector<std::vector<char>> keep;
+  for(int i = 0; i < 2; ++i) {
+    dout_RUSAGE("rusage test")
+    keep.emplace_back(4 << 20, 1);           // touches 4 MiB
+  }
+  for(int i = 0; i < 250; ++i) {
+    dout_RUSAGE_EVERY("rusage test every", 100)
+  }
+
+  std::stringstream ss(line_of("rusage test"));
+  std::size_t count, sampled;
+  ss >> count >> sampled;
+  CHECK(count == 2);
+  CHECK(sampled == 2);
+  std::stringstream every(line_of("rusage test every"));
+  every >> count >> sampled;
+  CHECK(count == 250);
+  CHECK(sampled == 3);
+#ifdef __linux__
+  const std::string line = line_of("rusage test");
+  CHECK(line.find(" MiB ") != std::string::npos);   // rss growth
+#endif
+  CHECK(report().find("DebugPrinter resource usage per sampled call:\n") != std::string::npos);
+}
+
+TEST_CASE("Throughput timers", "[profile]") {
+  std::vector<double> x(1 << 16, 1), y(x.size(), 2);
+  for(int i = 0; i < 10; ++i) {
+    dout_THROUGHPUT("throughput test", 3 * x.size() * sizeof(double), x.size())
+    for(std::size_t j = 0; j < x.size(); ++j)
+      y[j] += 0.5 * x[j];
+  }
+  CHECK(y[0] == 7);
+  CHECK(count_of("throughput test") == 10);
+
+  std::stringstream line(line_of("throughput test"));
+  std::size_t count;
+  std::string total, total_unit, mean, mean_unit, bytes, bytes_unit, bw, bw_unit;
+  line >> count >> total >> total_unit >> mean >> mean_unit >> bytes >> bytes_unit
+       >> bw >> bw_unit;
+  CHECK(bytes + " " + bytes_unit == "15.0 MiB");
+  CHECK(bw_unit.substr(1) == "B/s");
+
+  std::stringstream ss;
+  fsc::DebugPrinter d;
+  d = ss;
+  d.set_color();
+  d.set_report_at_exit(false);
+  d.set_peak_bandwidth(1e6);
+  d.report();
+  CHECK(ss.str().find("bandwidth   peak       items  site") != std::string::npos);
+  CHECK(ss.str().find("     0%") != std::string::npos);
+}
+
+namespace {
+  std::size_t occurrences(const std::string & s, const std::string & what) {
+    std::size_t n = 0;
+    for(std::size_t p = s.find(what); p != std::string::npos; p = s.find(what, p + 1))
+      ++n;
+    return n;
+  }
+}
+
+TEST_CASE("Trace timeline", "[profile]") {
+  std::stringstream ss;
+  fsc::DebugPrinter d;
+  d = ss;
+  d.set_color();
+  d.set_report_at_exit(false);
+  CHECK_FALSE(d.trace_stop());
+
+  scope_test_leaf();                          // not recorded
+  d.trace_start("profile_test_trace.json");
+  scope_test_root(1, 0);
+  std::thread worker([] {
+    dout_TRACE_INSTANT("trace \"test\" instant")
+    dout_TRACE_COUNTER("trace test counter", 42)
+  });
+  worker.join();
+  CHECK(d.trace_stop());
+  scope_test_leaf();                          // not recorded
+  CHECK(ss.str() == "profile_test_trace.json: 10 events\n");
+
+  std::ifstream in("profile_test_trace.json");
+  const std::string json((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+  CHECK(json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n") == 0);
+  CHECK(json.substr(json.size() - 4) == "\n]}\n");
+  CHECK(occurrences(json, "\"ph\":\"B\"") == 4);
+  CHECK(occurrences(json, "\"ph\":\"E\"") == 4);
+  CHECK(occurrences(json, "\"name\":\"scope test leaf\"") == 2);
+  CHECK(occurrences(json, "\"ph\":\"M\"") == 2);        // two threads
+  CHECK(json.find("\"ph\":\"i\",\"ts\":") != std::string::npos);
+  CHECK(json.find("\"name\":\"trace \\\"test\\\" instant\",\"s\":\"t\"}") != std::string::npos);
+  CHECK(json.find("\"name\":\"trace test counter\",\"args\":{\"value\":42}}") != std::string::npos);
+  in.close();
+
+  ss.str("");                                 // buffers are rewound
+  d.trace_start("profile_test_trace.json");
+  scope_test_root(1, 0);
+  CHECK(d.trace_stop());
+  CHECK(ss.str() == "profile_test_trace.json: 8 events\n");
+  std::remove("profile_test_trace.json");
+}
+
+TEST_CASE("Flow IDs", "[profile]") {
+  std::stringstream ss, log;
+  fsc::DebugPrinter d;
+  d = ss;
+  d.set_color();
+  d.set_report_at_exit(false);
+
+  CHECK(d.flow() == 0);
+  d("no flow", 1);
+  d.trace_start("profile_test_flow.json");
+  const std::uint64_t id = d.flow_capture();
+  CHECK(id != 0);
+  CHECK(d.flow() == 0);                        // not set for the producer
+  CHECK(d.flow_capture() != id);               // one flow per capture
+  d.set_flow(id);
+  CHECK(d.flow_capture() == id);               // keeps the current flow
+  d.set_flow();
+  std::thread worker([&] {
+    fsc::DebugPrinter w;
+    w = log;
+    w.set_color();
+    CHECK(w.flow() == 0);
+    {
+      dout_FLOW(id)
+      w("in flow", 2);
+      w.summary("summary", std::vector<int>{1});
+      w.hash("hash", 1);
+      CHECK(w.flow() == id);
+    }
+    CHECK(w.flow() == 0);
+  });
+  worker.join();
+  CHECK(d.trace_stop());
+  CHECK(ss.str().find("no flow: 1\n") == 0);
+  const std::string prefix = "[flow " + std::to_string(id) + "] ";
+  std::stringstream lines(log.str());
+  std::string line;
+  std::size_t n = 0;
+  for(; std::getline(lines, line); ++n)
+    CHECK(line.find(prefix) == 0);
+  CHECK(n == 3);
+  CHECK(log.str().find(prefix + "in flow: 2\n") == 0);
+
+  std::ifstream in("profile_test_flow.json");
+  const std::string json((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+  const std::string flow = ",\"cat\":\"flow\",\"id\":" + std::to_string(id);
+  CHECK(occurrences(json, "\"ph\":\"s\"") == 3);
+  CHECK(occurrences(json, "\"ph\":\"f\"") == 1);
+  CHECK(occurrences(json, "\"name\":\"flow\"" + flow + "}") == 2);
+  CHECK(occurrences(json, "\"name\":\"flow\"" + flow + ",\"bp\":\"e\"}") == 1);
+  CHECK(occurrences(json, "\"args\":{\"flow\":" + std::to_string(id) + "}") == 3);
+  in.close();
+  std::remove("profile_test_flow.json");
+}
+
+TEST_CASE("Microbenchmarks", "[profile]") {
+  std::stringstream ss;
+  fsc::DebugPrinter d;
+  d = ss;
+  d.set_color();
+  std::vector<double> v(1000, 1.5);
+  const double median = d.bench("sum", [&] {
+    return std::accumulate(v.begin(), v.end(), 0.);
+  }, 0.2);
+  CHECK(median > 0);
+  CHECK(median < 1e6);
+
+  std::stringstream line(ss.str());
+  std::string label, value, unit, ci;
+  line >> label >> value >> unit >> ci;
+  CHECK(label == "sum:");
+  CHECK(unit.substr(unit.size() - 3) == "/op");
+  CHECK(ci == "95%");
+  CHECK(ss.str().find(" calls") != std::string::npos);
+
+  int calls = 0;
+  ss.str("");
+  d.bench("void", [&] { ++calls; }, 0.05);         // void result
+  CHECK(calls > 0);
+  CHECK(ss.str().find("void: ") == 0);
+
+  std::stringstream out;
+  fsc::dout = out;
+  const double x = 2;
+  dout_BENCH(std::sqrt(x))
+  fsc::dout = std::cout;
+  CHECK(out.str().find("std::sqrt(x): ") != std::string::npos);
+}
@@ -0,0 +1,151 @@
+/** ****************************************************************************
+ * \file    usdt_test.cpp
+ * \brief   Tests the DebugPrinter USDT probes
+ * \author
+ * Year      | Name
+ * --------: | :------------
+ * 2026      | C.Frescolino
+ * \copyright  see LICENSE
+ ******************************************************************************/
+
+#define DEBUGPRINTER_USDT
+#include <catch.hpp>
+#include <fsc/DebugPrinter.hpp>
+
+#ifdef DEBUGPRINTER_USDT
+#include <elf.h>
+#include <link.h>
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+  struct usdt_note {
+    std::string provider, name, args;
+    std::uint64_t pc, semaphore;
+  };
+
+  // All stapsdt notes of the running executable
+  std::vector<usdt_note> usdt_notes() {
+    std::ifstream in("/proc/self/exe", std::ios::binary);
+    const std::string elf((std::istreambuf_iterator<char>(in)),
+                          std::istreambuf_iterator<char>());
+    std::vector<usdt_note> notes;
+    const auto & eh = *reinterpret_cast<const Elf64_Ehdr *>(elf.data());
+    const auto * sh = reinterpret_cast<const Elf64_Shdr *>(elf.data() + eh.e_shoff);
+    const char * names = elf.data() + sh[eh.e_shstrndx].sh_offset;
+    for(std::size_t i = 0; i < eh.e_shnum; ++i) {
+      if(std::string(names + sh[i].sh_name) != ".note.stapsdt")
+        continue;
+      const char * p = elf.data() + sh[i].sh_offset;
+      const char * end = p + sh[i].sh_size;
+      while(p < end) {
+        const auto & nh = *reinterpret_cast<const Elf64_Nhdr *>(p);
+        const char * desc = p + sizeof(nh) + ((nh.n_namesz + 3) & ~3u);
+        usdt_note n;
+        n.pc = reinterpret_cast<const std::uint64_t *>(desc)[0];
+        n.semaphore = reinterpret_cast<const std::uint64_t *>(desc)[2];
+        n.provider = desc + 24;
+        n.name = desc + 24 + n.provider.size() + 1;
+        n.args = desc + 24 + n.provider.size() + n.name.size() + 2;
+        notes.push_back(n);
+        p = desc + ((nh.n_descsz + 3) & ~3u);
+      }
+    }
+    return notes;
+  }
+
+  int usdt_printed = 0;
+  struct usdt_counted {};
+  std::ostream & operator<<(std::ostream & os, const usdt_counted &) {
+    ++usdt_printed;
+    return os << "counted";
+  }
+
+  void usdt_sites(const int i) {
+    dout_HERE
+    dout_VAL(i)
+    dout_COUNT("usdt_test count")
+    dout_TRIP("usdt_test trip", i)
+    if(dout_BRANCH(i > 1))
+      dout_HASH(i)
+    dout_TIMER("usdt_test timer")
+  }
+}
+
+TEST_CASE("USDT probe notes", "[usdt]") {
+  const std::vector<usdt_note> notes = usdt_notes();
+  std::uintptr_t bias = 0;
+  dl_iterate_phdr([](dl_phdr_info * info, std::size_t, void * data) {
+    *static_cast<std::uintptr_t *>(data) = info->dlpi_addr;
+    return 1;                                           // executable first
+  }, &bias);
+
+  int here = 0, val = 0, count = 0, trip = 0, branch = 0, scope = 0, dump = 0;
+  for(const usdt_note & n: notes) {
+    if(n.provider != "debugprinter")
+      continue;
+    CHECK(n.pc != 0);
+    if(n.name == "here") {
+      ++here;
+      CHECK(n.args.find("-8@") != std::string::npos);
+    } else if(n.name == "val") {
+      ++val;
+      CHECK(std::count(n.args.begin(), n.args.end(), '@') == 4);
+      CHECK(n.semaphore + bias == reinterpret_cast<std::uintptr_t>(
+            &fsc::usdt::debugprinter_val_semaphore));
+    } else if(n.name == "count")
+      ++count;
+    else if(n.name == "trip")
+      ++trip;
+    else if(n.name == "branch")
+      ++branch;
+    else if(n.name == "scope")
+      ++scope;
+    else if(n.name == "dump")
+      ++dump;
+  }
+  CHECK(here >= 1);
+  CHECK(val >= 1);
+  CHECK(count >= 1);
+  CHECK(trip >= 1);
+  CHECK(branch >= 1);
+  CHECK(scope >= 1);
+  CHECK(dump >= 1);
+}
+
+TEST_CASE("USDT probe semaphores", "[usdt]") {
+  std::stringstream ss;
+  fsc::dout = ss;
+  usdt_sites(1);                                        // no tracer, no probe
+
+  usdt_printed = 0;
+  dout_VAL(usdt_counted())
+  CHECK(usdt_printed == 1);
+
+  fsc::usdt::debugprinter_val_semaphore = 1;            // as if attached
+  fsc::usdt::debugprinter_here_semaphore = 1;
+  fsc::usdt::debugprinter_count_semaphore = 1;
+  fsc::usdt::debugprinter_trip_semaphore = 1;
+  fsc::usdt::debugprinter_branch_semaphore = 1;
+  fsc::usdt::debugprinter_scope_semaphore = 1;
+  fsc::usdt::debugprinter_dump_semaphore = 1;
+  dout_VAL(usdt_counted())
+  CHECK(usdt_printed == 3);
+  usdt_sites(2);                                        // probes are no-ops
+  fsc::usdt::debugprinter_val_semaphore = 0;
+  fsc::usdt::debugprinter_here_semaphore = 0;
+  fsc::usdt::debugprinter_count_semaphore = 0;
+  fsc::usdt::debugprinter_trip_semaphore = 0;
+  fsc::usdt::debugprinter_branch_semaphore = 0;
+  fsc::usdt::debugprinter_scope_semaphore = 0;
+  fsc::usdt::debugprinter_dump_semaphore = 0;
+  fsc::dout = std::cout;
+
+  CHECK(ss.str().find("usdt_counted() = counted") != std::string::npos);
+  CHECK(ss.str().find("i = 2") != std::string::npos);
+}
+#endif // DEBUGPRINTER_USDT